@@ -0,0 +1,136 @@
+#define _POSIX_C_SOURCE 200112L
+#include <time.h>
+#include "../include/planar.h"
+
+/*
+ * Times the Planar kernels against the per-bit path they replaced, on a
+ * full VRAM bank of pseudo-random tiles. Each figure is the best of RUNS.
+ *
+ *     cmake --build build --target bench_planar && ./build/bench_planar
+ */
+
+#define TILES  384
+#define ROWS   (TILES * 8)
+#define RUNS   12
+#define PASSES 2000
+
+static uint8_t planes[ROWS * 2];
+static uint64_t decoded[ROWS];
+static uint64_t flipped[ROWS];
+static uint32_t pixels[ROWS * 8];
+static const uint32_t palette[4] = {
+    0xFFFFFFFF, 0xFFAAAAAA, 0xFF555555, 0xFF000000};
+
+static uint64_t now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/*
+ * The tile viewer's display_tile before the cache: called once per tile,
+ * with the palette read through a pointer that may alias the output.
+ */
+static void __attribute__((noinline)) display_tile(
+    const uint8_t *data, const uint32_t *colors, uint32_t *out)
+{
+    for (int32_t row = 0; row < 8; row++) {
+        uint8_t lo = data[row * 2];
+        uint8_t hi = data[(row * 2) + 1];
+
+        for (int32_t bit = 7; bit >= 0; bit--) {
+            uint8_t index = (((hi >> bit) & 1) << 1) | ((lo >> bit) & 1);
+
+            out[(row * 8) + 7 - bit] = colors[index];
+        }
+    }
+}
+
+static void per_bit(PlanarClass UNUSED *planar)
+{
+    for (int32_t tile = 0; tile < TILES; tile++) {
+        display_tile(planes + (tile * 16), palette, pixels + (tile * 64));
+    }
+}
+
+static void decode(PlanarClass *planar)
+{
+    planar->decode(planar, planes, ROWS, decoded, flipped);
+}
+
+static void colorize(PlanarClass *planar)
+{
+    for (int32_t row = 0; row < ROWS; row++) {
+        planar->colorize(planar, decoded[row], palette, pixels + (row * 8));
+    }
+}
+
+static void decode_colorize(PlanarClass *planar)
+{
+    decode(planar);
+    colorize(planar);
+}
+
+/* Best time over RUNS, in nanoseconds per unit of work */
+static double measure(
+    PlanarClass *planar, void (*kernel)(PlanarClass *), uint32_t units)
+{
+    double best = 0.0;
+
+    for (int32_t run = 0; run < RUNS; run++) {
+        uint64_t start = now();
+
+        for (int32_t pass = 0; pass < PASSES; pass++) {
+            kernel(planar);
+            __asm__ volatile("" : : "r"(pixels), "r"(decoded) : "memory");
+        }
+
+        double ns = (double) (now() - start) / PASSES / units;
+        if (!run || ns < best) {
+            best = ns;
+        }
+    }
+    return best;
+}
+
+int main(void)
+{
+    PlanarClass *planar = new_class(Planar);
+    uint32_t seed = 0x2545F491;
+
+    for (size_t i = 0; i < sizeof(planes); i++) {
+        seed = (seed * 1103515245) + 12345;
+        planes[i] = seed >> 24;
+    }
+
+    /* the kernels must agree with the path they replace */
+    per_bit(planar);
+    uint32_t expected = 0;
+    for (int32_t i = 0; i < ROWS * 8; i++) {
+        expected = (expected * 31) + pixels[i];
+    }
+    decode_colorize(planar);
+    uint32_t actual = 0;
+    for (int32_t i = 0; i < ROWS * 8; i++) {
+        actual = (actual * 31) + pixels[i];
+    }
+    if (actual != expected) {
+        HANDLE_ERROR("kernel output differs from the per-bit path");
+    }
+
+    printf("kernel: %s, best of %d runs\n", planar->kernel, RUNS);
+    printf("per-bit display_tile     %6.2f ns / 8 pixels\n",
+        measure(planar, per_bit, ROWS));
+    printf("decode (both flips)      %6.2f ns / tile\n",
+        measure(planar, decode, TILES));
+    printf("colorize                 %6.2f ns / 8 pixels\n",
+        measure(planar, colorize, ROWS));
+    printf("decode + colorize        %6.2f ns / 8 pixels\n",
+        measure(planar, decode_colorize, ROWS));
+
+    destroy_class(planar);
+
+    return 0;
+}
@@ -13,11 +13,13 @@ typedef struct bus_aux {
     /* Properties */
     class_t metadata;
     GameboyClass *parent;
+    bus_context_t *context;
     /* Methods */
     uint8_t (*read)(BusClass *, uint16_t);
     void (*write)(BusClass *, uint16_t, uint8_t);
     uint16_t (*read16)(BusClass *, uint16_t);
     void (*write16)(BusClass *, uint16_t, uint16_t);
+    void (*remap)(BusClass *);
 } BusClass;
 
 extern const class_t *Bus;
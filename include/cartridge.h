@@ -17,8 +17,11 @@ typedef struct cartridge_aux {
     const char *(*get_license)(CartridgeClass *);
     const char *(*get_rom_type)(CartridgeClass *);
     bool (*load)(CartridgeClass *, const char *);
+    bool (*load_memory)(CartridgeClass *, const uint8_t *, size_t);
     uint8_t (*read)(CartridgeClass *, uint16_t);
     void (*write)(CartridgeClass *, uint16_t, uint8_t);
+    const uint8_t *(*rom_bank)(CartridgeClass *, uint16_t);
+    uint8_t *(*ram_page)(CartridgeClass *, bool);
     bool (*mbc_1)(CartridgeClass *);
     bool (*mbc_2)(CartridgeClass *);
     bool (*mbc_3)(CartridgeClass *);
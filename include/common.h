@@ -1,6 +1,12 @@
-#include <SDL2/SDL.h>
+#ifndef HEADLESS
+    #include <SDL2/SDL.h>
+#endif
+#include <math.h>
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <stdint.h>
+#include <stdio.h>
+#include <time.h>
 
 #ifndef __COMMON
     #define __COMMON
@@ -103,8 +109,10 @@
     #define LCD_PCM34        0xFF77
     #define INST_BUFF_LEN    16
     #define START_LOCATION   0x8000
+    #define TILE_COUNT       384
     #define LCD_Y_COORD      0xFF44
     #define LCD_CONTROL      0xFF40
+    #define LCD_STATUS       0xFF41
     #define LCD_BG_PAL       0xFF47
     #define LCD_S1_PAL       0xFF48
     #define LCD_S2_PAL       0xFF49
@@ -129,8 +137,30 @@
     #define TICKS_PER_LINE   456
     #define Y_RES            144
     #define X_RES            160
+    #define FRAME_BUFFERS    3
+    #define FRAME_NEW        0x04
     #define FPS              60
+    #define DOTS_PER_SECOND  4194304
+    #define PACE_SPIN_NS     200000
+    #define PACE_AUDIO_FILL  (AUDIO_SAMPLES * 2)
+    #define PACE_AUDIO_DRC   0.005
+    #define BATTERY_SAVE_NS  1000000000ULL
+    #define STATE_MAGIC      0x54534247
+    #define STATE_VERSION    8
+    #define STATE_NONE       -1
+    #define STATE_CHUNKS     14
+    #define STATE_VIDEO      13
+    #define STATE_ALL        ((1 << STATE_CHUNKS) - 1)
+    #define STATE_NO_VIDEO   (STATE_ALL & ~(1 << STATE_VIDEO))
+    #define REWIND_FRAMES    (60 * FPS)
+    #define REWIND_KEYFRAME  FPS
+    #define REWIND_CAPACITY  (48 << 20)
+    #define BLOCK_CACHE_SIZE 1024
+    #define BLOCK_MAX_OPS    32
+    #define STATE_TAG(a, b, c, d) \
+        ((uint32_t) (a) | ((b) << 8) | ((c) << 16) | ((uint32_t) (d) << 24))
     #define MAX_FIFO_ITEMS   8
+    #define FIFO_CAPACITY    (MAX_FIFO_ITEMS * 2)
     #define OAM_ENTRIES      40
     #define MAX_SPRITES      10
     #define LCDC_BGW_ENABLE  (BIT(self->parent->lcd->context->control, 0))
@@ -145,15 +175,44 @@
     #define LCDC_WIN_MAP_AREA \
         (BIT(self->parent->lcd->context->control, 6) ? 0x9C00 : 0x9800)
     #define LCDC_LCD_ENABLE   (BIT(self->parent->lcd->context->control, 7))
-    #define CPU_FLAG_Z        BIT(cpu->context->registers.f, 7)
-    #define CPU_FLAG_N        BIT(cpu->context->registers.f, 6)
-    #define CPU_FLAG_H        BIT(cpu->context->registers.f, 5)
-    #define CPU_FLAG_C        BIT(cpu->context->registers.f, 4)
+    #define CPU_FLAG_Z        BIT(cpu->flags(cpu), 7)
+    #define CPU_FLAG_N        BIT(cpu->flags(cpu), 6)
+    #define CPU_FLAG_H        BIT(cpu->flags(cpu), 5)
+    #define CPU_FLAG_C        BIT(cpu->flags(cpu), 4)
     #define AUDIO_FREQUENCY   44100
     #define AUDIO_FORMAT      AUDIO_S16SYS
     #define AUDIO_CHANNELS    2
-    #define AUDIO_SAMPLES     1024
+    #define AUDIO_SAMPLES     512
     #define AUDIO_MAX_SAMPLES 4096
+    #define AUDIO_RING_FRAMES 65536
+    #define AUDIO_SYNC_FRAMES (AUDIO_SAMPLES / 4)
+    #define APU_FRAME_TICKS   (DOTS_PER_SECOND / 512)
+    #define APU_OUTPUT_GAIN   (32767 / (4 * 30 * 7))
+    #define BLIP_TAPS         16
+    #define BLIP_PHASES       32
+    #define BLIP_BITS         15
+    #define BLIP_BUFFER_SIZE  256
+    #define LFSR_BITS         15
+    #define LFSR_JUMPS        32
+    #if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        #define REGISTER_PAIR(hi, lo) \
+            union {                   \
+                struct {              \
+                    uint8_t hi;       \
+                    uint8_t lo;       \
+                };                    \
+                uint16_t hi##lo;      \
+            }
+    #else
+        #define REGISTER_PAIR(hi, lo) \
+            union {                   \
+                struct {              \
+                    uint8_t lo;       \
+                    uint8_t hi;       \
+                };                    \
+                uint16_t hi##lo;      \
+            }
+    #endif
 
 typedef enum { HW_DMG, HW_CGB } hardware_mode_t;
 
@@ -162,11 +221,12 @@ typedef struct {
     bool running;
     bool die;
     uint64_t ticks;
-    uint32_t prev_frame;
+    uint32_t frame_limit;
     hardware_mode_t hw_mode;
     bool double_speed;
     bool speed_switch_armed;
     uint16_t stop_cycles_remaining;
+    bool skip_idle;
 } emulator_context_t;
 
 typedef struct {
@@ -186,14 +246,26 @@ typedef struct {
     uint16_t global_checksum;
 } rom_header_t;
 
+typedef struct rom_image {
+    char path[1024];
+    time_t modified;
+    uint64_t hash;
+    uint32_t size;
+    uint32_t references;
+    uint8_t *data;
+    struct rom_image *next;
+} rom_image_t;
+
 typedef struct {
     char filename[1024];
+    char title[16];
     uint32_t rom_size;
-    uint8_t *rom_data;
-    rom_header_t *header;
+    rom_image_t *image;
+    const uint8_t *rom_data;
+    const rom_header_t *header;
     bool ram_enabled;
     bool ram_banking;
-    uint8_t *rom_bank_x;
+    const uint8_t *rom_bank_x;
     uint8_t banking_mode;
     uint16_t rom_bank_value;
     uint8_t ram_bank_value;
@@ -224,14 +296,15 @@ typedef struct {
 } cartridge_context_t;
 
 typedef struct {
-    uint8_t a;
-    uint8_t f;
-    uint8_t b;
-    uint8_t c;
-    uint8_t d;
-    uint8_t e;
-    uint8_t h;
-    uint8_t l;
+    const uint8_t *read_pages[0x100];
+    uint8_t *write_pages[0x100];
+} bus_context_t;
+
+typedef struct {
+    REGISTER_PAIR(a, f);
+    REGISTER_PAIR(b, c);
+    REGISTER_PAIR(d, e);
+    REGISTER_PAIR(h, l);
     uint16_t pc;
     uint16_t sp;
 } registers_t;
@@ -346,13 +419,27 @@ typedef struct {
     uint8_t parameter;
 } instruction_t;
 
+typedef enum {
+    LAZY_NONE,
+    LAZY_ADD,
+    LAZY_SUB,
+    LAZY_AND,
+    LAZY_OR,
+    LAZY_INC,
+    LAZY_DEC,
+} lazy_op_t;
+
+typedef struct {
+    lazy_op_t op;
+    uint8_t x;
+    uint8_t y;
+    uint8_t carry;
+} lazy_flags_t;
+
 typedef struct {
     registers_t registers;
-    uint16_t fetched_data;
-    uint16_t mem_dest;
-    bool dest_is_mem;
+    lazy_flags_t lazy;
     uint8_t opcode;
-    instruction_t *inst;
     bool halted;
     bool stepping;
     bool int_master_enabled;
@@ -363,7 +450,26 @@ typedef struct {
 
 typedef struct cpu_aux CPUClass;
 
-typedef void (*proc_fn)(CPUClass *);
+typedef struct operation operation_t;
+typedef void (*proc_fn)(CPUClass *, const operation_t *);
+
+typedef struct operation {
+    proc_fn handler;
+    uint8_t *target;
+    uint8_t *source;
+    uint16_t *target_pair;
+    uint16_t *source_pair;
+    uint16_t vector;
+    uint8_t mask;
+    uint8_t flags;
+} operation_t;
+
+typedef struct {
+    const uint8_t *page;
+    uint16_t addresses[BLOCK_MAX_OPS];
+    const operation_t *operations[BLOCK_MAX_OPS];
+    uint8_t length;
+} block_t;
 
 typedef struct {
     uint8_t wram[0x8000];
@@ -384,8 +490,31 @@ typedef struct {
     uint8_t tima;
     uint8_t tma;
     uint8_t tac;
+    uint64_t last_sync;
 } timer_context_t;
 
+typedef enum {
+    EV_TIMER,
+    EV_PPU,
+    EV_HDMA,
+    EV_DMA,
+    EV_SERIAL,
+    EV_SOUND,
+    EV_COUNT,
+} event_type_t;
+
+typedef struct {
+    uint64_t deadline;
+    event_type_t type;
+} event_t;
+
+typedef struct {
+    event_t heap[EV_COUNT];
+    int8_t position[EV_COUNT];
+    uint8_t size;
+    uint64_t target;
+} scheduler_context_t;
+
 typedef struct {
     uint8_t y;
     uint8_t x;
@@ -406,17 +535,16 @@ typedef enum {
     FS_PUSH,
 } fetch_state_t;
 
-typedef struct fifo_entry fifo_entry_t;
-
-typedef struct fifo_entry {
-    fifo_entry_t *next;
-    uint32_t value;
-} fifo_entry_t;
+typedef enum {
+    RENDERER_FIFO,
+    RENDERER_SCANLINE,
+} renderer_t;
 
 typedef struct {
-    fifo_entry_t *head;
-    fifo_entry_t *tail;
-    uint32_t size;
+    uint32_t entries[FIFO_CAPACITY];
+    uint8_t head;
+    uint8_t tail;
+    uint8_t size;
 } fifo_t;
 
 typedef struct {
@@ -425,8 +553,10 @@ typedef struct {
     uint8_t line_x;
     uint8_t pushed_x;
     uint8_t fetch_x;
-    uint8_t bg_fetch_data[4];
-    uint8_t fetch_entry_data[6];
+    uint8_t bg_tile;
+    uint8_t bg_attributes;
+    uint64_t bg_row;
+    uint64_t sprite_rows[3];
     uint8_t map_y;
     uint8_t map_x;
     uint8_t tile_y;
@@ -437,6 +567,8 @@ typedef struct {
     oam_entry_t oam_ram[OAM_ENTRIES];
     uint8_t vram[0x4000];
     uint8_t vram_bank;
+    atomic_uint_least32_t tile_dirty[(TILE_COUNT * 2) / 32];
+    uint64_t (*tile_cache)[TILE_COUNT][2][8];
     fifo_context_t *pixel_context;
     uint8_t line_sprite_count;
     oam_line_entry_t *line_sprites;
@@ -446,9 +578,19 @@ typedef struct {
     uint8_t window_line;
     uint32_t current_frame;
     uint32_t line_ticks;
+    uint64_t last_sync;
+    uint64_t last_save;
     uint32_t *video_buffer;
+    uint32_t *frames[FRAME_BUFFERS];
+    uint8_t back_frame;
+    uint8_t front_frame;
+    atomic_uint_least8_t ready_frame;
     bool window_triggered;
     bool window_rendered_this_line;
+    renderer_t renderer;
+    bool scanline_pending;
+    uint32_t transfer_start;
+    uint32_t transfer_end;
 } ppu_context_t;
 
 typedef struct {
@@ -456,6 +598,7 @@ typedef struct {
     uint8_t byte;
     uint8_t value;
     uint8_t start_delay;
+    uint64_t base;
 } dma_context_t;
 
 typedef struct {
@@ -533,76 +676,105 @@ typedef struct {
 
 typedef struct {
     bool enabled;
+    bool length_enabled;
+    bool sweep_enabled;
     uint8_t volume;
     uint8_t freq_lo;
     uint8_t freq_hi;
     uint8_t sweep_time;
     uint8_t sweep_direction;
     uint8_t sweep_shift;
+    uint8_t sweep_timer;
     uint8_t wave_duty;
+    uint8_t duty_step;
     uint8_t length;
     uint8_t initial_volume;
     uint8_t envelope_direction;
     uint8_t envelope_sweep;
+    uint8_t envelope_timer;
+    uint16_t length_counter;
+    uint16_t shadow_frequency;
     uint32_t frequency;
     uint32_t period;
-    uint32_t duty_cycle;
-    uint16_t lfsr;
-    float_t time_counter;
-    float_t envelope_counter;
-    float_t sweep_counter;
+    uint32_t timer;
 } sound_channel1_t;
 
 typedef struct {
     bool enabled;
+    bool length_enabled;
     uint8_t volume;
     uint8_t freq_lo;
     uint8_t freq_hi;
     uint8_t wave_duty;
+    uint8_t duty_step;
     uint8_t length;
     uint8_t initial_volume;
     uint8_t envelope_direction;
     uint8_t envelope_sweep;
+    uint8_t envelope_timer;
+    uint16_t length_counter;
     uint32_t frequency;
     uint32_t period;
-    uint32_t duty_cycle;
-    float_t time_counter;
-    float_t envelope_counter;
+    uint32_t timer;
 } sound_channel2_t;
 
 typedef struct {
     bool enabled;
+    bool length_enabled;
     uint8_t volume;
     uint8_t freq_lo;
     uint8_t freq_hi;
     uint8_t length;
     uint8_t output_level;
+    uint8_t position;
+    uint16_t length_counter;
     uint32_t frequency;
     uint32_t period;
-    float_t time_counter;
+    uint32_t timer;
     uint8_t wave_pattern[32];
 } sound_channel3_t;
 
 typedef struct {
     bool enabled;
+    bool length_enabled;
     uint8_t volume;
     uint8_t length;
     uint8_t initial_volume;
     uint8_t envelope_direction;
     uint8_t envelope_sweep;
+    uint8_t envelope_timer;
     uint8_t shift_clock_freq;
     uint8_t counter_width;
     uint8_t dividing_ratio;
-    uint32_t period;
+    uint16_t length_counter;
     uint16_t lfsr;
-    float_t time_counter;
-    float_t envelope_counter;
+    uint32_t period;
+    uint32_t timer;
 } sound_channel4_t;
 
+/* Band-limited steps: amplitude deltas are spread over BLIP_TAPS samples */
+typedef struct {
+    int16_t kernel[BLIP_PHASES][BLIP_TAPS];
+    int32_t buffer[BLIP_BUFFER_SIZE][AUDIO_CHANNELS];
+    int32_t integrator[AUDIO_CHANNELS];
+    int32_t level[AUDIO_CHANNELS];
+} blip_buffer_t;
+
+typedef struct {
+    int16_t frames[AUDIO_RING_FRAMES][AUDIO_CHANNELS];
+    atomic_uint_least32_t head;
+    atomic_uint_least32_t tail;
+    atomic_uint_least32_t underruns;
+    atomic_uint_least32_t overruns;
+    atomic_uint_least32_t trim;
+} audio_ring_t;
+
 typedef struct {
     bool initialized;
+#ifndef HEADLESS
     SDL_AudioDeviceID device;
     SDL_AudioSpec spec;
+#endif
     uint8_t master_volume;
     uint8_t channel_control;
     uint8_t output_select;
@@ -611,6 +783,69 @@ typedef struct {
     sound_channel2_t channel2;
     sound_channel3_t channel3;
     sound_channel4_t channel4;
+    uint64_t last_sync;
+    uint64_t sample_phase;
+    uint32_t rate;
+    blip_buffer_t blip;
+    uint16_t lfsr_jump[2][LFSR_JUMPS][LFSR_BITS];
+    audio_ring_t ring;
 } sound_context_t;
 
+typedef enum {
+    PACE_REALTIME,
+    PACE_SCALED,
+    PACE_AUDIO,
+    PACE_UNLIMITED
+} pace_mode_t;
+
+typedef struct {
+    pace_mode_t mode;
+    pace_mode_t resume_mode;
+    double speed;
+    uint64_t frame_ns;
+    uint64_t deadline;
+    double fill;
+    uint32_t last_frame;
+    uint32_t played;
+    uint64_t played_at;
+    bool stalled;
+    atomic_uint_least32_t toggles;
+} pacer_context_t;
+
+typedef enum { STATE_IDLE, STATE_SAVE, STATE_LOAD } state_request_t;
+
+typedef struct {
+    uint8_t *data;
+    size_t size;
+    size_t position;
+    bool loading;
+    bool failed;
+} state_stream_t;
+
+typedef struct {
+    atomic_int request;
+} state_context_t;
+
+typedef struct {
+    uint32_t offset;
+    uint32_t length;
+    uint32_t keyframe;
+} rewind_entry_t;
+
+typedef struct {
+    bool enabled;
+    bool rewinding;
+    uint8_t *ring;
+    uint64_t *snapshot;
+    uint64_t *base;
+    size_t state_size;
+    size_t words;
+    rewind_entry_t entries[REWIND_FRAMES];
+    uint32_t first;
+    uint32_t count;
+    uint32_t write;
+    int64_t base_seq;
+    uint32_t last_frame;
+} rewind_context_t;
+
 #endif
@@ -16,14 +16,17 @@ typedef struct cpu_aux {
     GameboyClass *parent;
     register_type_t register_lookup[8];
     char *str_register_lookup[15];
+    operation_t operations[0x100];
+    operation_t cb_operations[0x100];
+    block_t *blocks;
     /* Methods */
     bool (*step)(CPUClass *);
-    void (*fetch_instructions)(CPUClass *);
-    void (*fetch_data)(CPUClass *);
-    void (*execute)(CPUClass *);
+    const block_t *(*block)(CPUClass *, uint16_t);
+    void (*run_block)(CPUClass *, const block_t *);
+    int32_t (*idle_cycles)(CPUClass *);
+    void (*skip_idle)(CPUClass *, const operation_t *, int8_t);
     void (*set_flags)(CPUClass *, char, char, char, char);
-    bool (*check_condition)(CPUClass *);
-    uint16_t (*reverse)(uint16_t);
+    uint8_t (*flags)(CPUClass *);
     uint16_t (*read_register)(CPUClass *, register_type_t);
     void (*set_register)(CPUClass *, register_type_t, uint16_t);
     void (*set_ie_register)(CPUClass *, uint8_t);
@@ -31,8 +34,6 @@ typedef struct cpu_aux {
     registers_t *(*get_registers)(CPUClass *);
     bool (*is_16bit)(register_type_t);
     register_type_t (*decode_register)(CPUClass *, uint8_t);
-    uint8_t (*read_register8)(CPUClass *, register_type_t);
-    void (*set_register8)(CPUClass *, register_type_t, uint8_t);
     uint8_t (*get_int_flags)(CPUClass *);
     void (*set_int_flags)(CPUClass *, uint8_t);
     void (*int_handle)(CPUClass *, uint16_t);
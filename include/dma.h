@@ -15,6 +15,9 @@ typedef struct dma_aux {
     /* Methods */
     void (*start)(DMAClass *, uint8_t);
     void (*tick)(DMAClass *);
+    void (*sync)(DMAClass *, uint64_t);
+    void (*schedule)(DMAClass *);
+    void (*retime)(DMAClass *);
     bool (*transferring)(DMAClass *);
 } DMAClass;
 
@@ -10,11 +10,16 @@
 #include "joypad.h"
 #include "lcd.h"
 #include "oop.h"
+#include "pacer.h"
 #include "pipeline.h"
+#include "planar.h"
 #include "ppu.h"
 #include "ram.h"
+#include "rewind.h"
+#include "scheduler.h"
 #include "sound.h"
 #include "stack.h"
+#include "state.h"
 #include "timer.h"
 #include "ui.h"
 
@@ -40,11 +45,18 @@ typedef struct gameboy_aux {
     DMAClass *dma;
     LCDClass *lcd;
     PipelineClass *pipeline;
+    PlanarClass *planar;
     JoypadClass *joypad;
     SoundClass *sound;
+    SchedulerClass *scheduler;
+    PacerClass *pacer;
+    StateClass *state;
+    RewindClass *rewind;
     emulator_context_t *context;
     /* Methods */
     int32_t (*run)(GameboyClass *, int32_t, char **);
+    void (*boot)(GameboyClass *);
+    uint32_t (*run_frames)(GameboyClass *, uint32_t);
     void (*cycles)(GameboyClass *, int32_t);
     void *(*cpu_run)(void *);
     void (*loop)(void *);
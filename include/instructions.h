@@ -11,11 +11,13 @@ typedef struct instructions_aux {
     class_t metadata;
     instruction_t instructions[0x100];
     char *lookup_table[48];
-    proc_fn processors[36];
     /* Methods */
-    proc_fn (*get_proc)(InstructionsClass *, instruction_type_t);
     instruction_t *(*by_opcode)(InstructionsClass *, uint8_t);
     char *(*lookup)(InstructionsClass *, instruction_type_t);
+    operation_t (*decode)(InstructionsClass *, CPUClass *, uint8_t);
+    operation_t (*decode_cb)(InstructionsClass *, CPUClass *, uint8_t);
+    uint8_t (*length)(InstructionsClass *, uint8_t);
+    bool (*branches)(InstructionsClass *, uint8_t);
 } InstructionsClass;
 
 extern const class_t *Instructions;
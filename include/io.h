@@ -15,6 +15,8 @@ typedef struct io_aux {
     /* Methods */
     uint8_t (*read)(IOClass *, uint16_t);
     void (*write)(IOClass *, uint16_t, uint8_t);
+    void (*serial_start)(IOClass *);
+    void (*serial_tick)(IOClass *);
 } IOClass;
 
 extern const class_t *IO;
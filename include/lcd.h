@@ -19,6 +19,8 @@ typedef struct lcd_aux {
     void (*update)(LCDClass *, uint8_t, uint8_t);
     void (*hdma_start)(LCDClass *, uint8_t);
     void (*hdma_tick)(LCDClass *);
+    void (*hdma_block)(LCDClass *);
+    void (*hdma_hblank)(LCDClass *);
 } LCDClass;
 
 extern const class_t *LCD;
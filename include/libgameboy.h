@@ -0,0 +1,68 @@
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef __LIBGAMEBOY
+    #define __LIBGAMEBOY
+
+    #define GB_SCREEN_WIDTH  160
+    #define GB_SCREEN_HEIGHT 144
+
+typedef enum {
+    GB_BUTTON_A = (1 << 0),
+    GB_BUTTON_B = (1 << 1),
+    GB_BUTTON_SELECT = (1 << 2),
+    GB_BUTTON_START = (1 << 3),
+    GB_BUTTON_RIGHT = (1 << 4),
+    GB_BUTTON_LEFT = (1 << 5),
+    GB_BUTTON_UP = (1 << 6),
+    GB_BUTTON_DOWN = (1 << 7),
+} gb_button_t;
+
+typedef struct gameboy_aux gb_t;
+
+/*
+ * Embeddable core. Every call runs synchronously on the caller's thread:
+ * there is no emulation thread, no window, no audio device and no frame
+ * pacing.
+ */
+
+/* Copies the ROM image; returns NULL if it cannot be loaded */
+gb_t *gb_create_from_memory(const uint8_t *rom, size_t size);
+
+/* Emulates up to count frames and returns how many were completed */
+uint32_t gb_run_frames(gb_t *gb, uint32_t count);
+
+/* Sets the pressed buttons as a gb_button_t mask */
+void gb_set_input(gb_t *gb, uint8_t buttons);
+
+/* Fast-forwards JR self-loops and LY/STAT polling loops; off by default */
+void gb_set_skip_idle(gb_t *gb, int enabled);
+
+/*
+ * The last completed frame as GB_SCREEN_WIDTH * GB_SCREEN_HEIGHT ARGB
+ * pixels. The buffer is reused once two more frames have been emulated,
+ * so fetch it again after each gb_run_frames.
+ */
+const uint32_t *gb_get_framebuffer(gb_t *gb);
+
+/*
+ * Drains up to frames interleaved stereo S16 samples produced by emulation
+ * since the last call and returns the count. 65536 frames, about 1.5
+ * seconds at 44.1 kHz, are buffered; newer samples are dropped once full.
+ */
+size_t gb_get_audio(gb_t *gb, int16_t *buffer, size_t frames);
+
+/* Frames dropped so far because gb_get_audio was not called often enough */
+uint32_t gb_get_audio_overruns(gb_t *gb);
+
+/* Bytes needed by gb_save_state for the loaded ROM */
+size_t gb_state_size(gb_t *gb);
+
+/* Writes a snapshot and returns its size, or 0 if capacity is too small */
+size_t gb_save_state(gb_t *gb, uint8_t *buffer, size_t capacity);
+
+/* Restores a snapshot of the same ROM; the machine is untouched on failure */
+int gb_load_state(gb_t *gb, const uint8_t *buffer, size_t size);
+
+void gb_destroy(gb_t *gb);
+#endif
@@ -0,0 +1,27 @@
+#include "common.h"
+#include "oop.h"
+
+#ifndef __PACER
+    #define __PACER
+
+typedef struct gameboy_aux GameboyClass;
+typedef struct pacer_aux PacerClass;
+
+typedef struct pacer_aux {
+    /* Properties */
+    class_t metadata;
+    GameboyClass *parent;
+    pacer_context_t *context;
+    /* Methods */
+    void (*set)(PacerClass *, pace_mode_t, double);
+    bool (*parse)(PacerClass *, const char *);
+    void (*toggle)(PacerClass *);
+    void (*fast_forward)(PacerClass *);
+    void (*frame)(PacerClass *);
+    bool (*drain)(PacerClass *);
+    uint64_t (*now)(void);
+    void (*wait)(PacerClass *, uint64_t);
+} PacerClass;
+
+extern const class_t *Pacer;
+#endif
@@ -14,15 +14,18 @@ typedef struct pipeline_aux {
     /* Methods */
     void (*fetch)(PipelineClass *);
     void (*process)(PipelineClass *);
+    void (*render_line)(PipelineClass *);
+    void (*load_tile)(PipelineClass *);
+    void (*load_tile_data)(PipelineClass *);
+    uint32_t (*pixel_color)(PipelineClass *, int8_t);
     uint32_t (*fifo_pop)(PipelineClass *);
     void (*fifo_push)(PipelineClass *, uint32_t);
     bool (*fifo_add)(PipelineClass *);
     void (*fifo_reset)(PipelineClass *);
     void (*push_pixel)(PipelineClass *);
     void (*load_sprite_tile)(PipelineClass *);
-    void (*load_sprite_data)(PipelineClass *, uint8_t);
-    uint32_t (*fetch_sprite_pixels)(
-        PipelineClass *, int32_t, uint32_t, uint8_t, bool);
+    void (*load_sprite_data)(PipelineClass *);
+    uint32_t (*fetch_sprite_pixels)(PipelineClass *, uint32_t, uint8_t, bool);
     bool (*visible)(PipelineClass *);
     void (*load_window_tile)(PipelineClass *);
 } PipelineClass;
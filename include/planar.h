@@ -0,0 +1,21 @@
+#include "common.h"
+#include "oop.h"
+
+#ifndef __PLANAR
+    #define __PLANAR
+
+typedef struct planar_aux PlanarClass;
+
+typedef struct planar_aux {
+    /* Properties */
+    class_t metadata;
+    const char *kernel;
+    uint64_t spread[2][256];
+    /* Methods */
+    void (*decode)(
+        PlanarClass *, const uint8_t *, size_t, uint64_t *, uint64_t *);
+    void (*colorize)(PlanarClass *, uint64_t, const uint32_t *, uint32_t *);
+} PlanarClass;
+
+extern const class_t *Planar;
+#endif
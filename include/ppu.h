@@ -12,16 +12,18 @@ typedef struct ppu_aux {
     class_t metadata;
     GameboyClass *parent;
     ppu_context_t *context;
-    size_t target_time;
-    size_t prev_time;
-    size_t start_timer;
-    size_t frame_count;
     /* Methods */
     void (*tick)(PPUClass *);
+    void (*sync)(PPUClass *);
+    void (*schedule)(PPUClass *);
     void (*oam_write)(PPUClass *, uint16_t, uint8_t);
     uint8_t (*oam_read)(PPUClass *, uint16_t);
     void (*vram_write)(PPUClass *, uint16_t, uint8_t);
     uint8_t (*vram_read)(PPUClass *, uint16_t);
+    void (*touch_tile)(PPUClass *, uint16_t, uint16_t);
+    void (*fallback)(PPUClass *);
+    void (*publish)(PPUClass *);
+    bool (*present)(PPUClass *);
     /* State */
     void (*increment_y)(PPUClass *);
     void (*mode_hblank)(PPUClass *);
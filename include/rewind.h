@@ -0,0 +1,26 @@
+#include "common.h"
+#include "oop.h"
+
+#ifndef __REWIND
+    #define __REWIND
+
+typedef struct gameboy_aux GameboyClass;
+typedef struct rewind_aux RewindClass;
+
+typedef struct rewind_aux {
+    /* Properties */
+    class_t metadata;
+    GameboyClass *parent;
+    rewind_context_t *context;
+    /* Methods */
+    void (*frame)(RewindClass *);
+    void (*record)(RewindClass *);
+    void (*step_back)(RewindClass *);
+    void (*restore)(RewindClass *, uint32_t);
+    void (*drop)(RewindClass *);
+    void (*evict)(RewindClass *);
+    void (*set_rewinding)(RewindClass *, bool);
+} RewindClass;
+
+extern const class_t *Rewind;
+#endif
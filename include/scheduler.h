@@ -0,0 +1,26 @@
+#include "common.h"
+#include "oop.h"
+
+#ifndef __SCHEDULER
+    #define __SCHEDULER
+
+typedef struct gameboy_aux GameboyClass;
+typedef struct scheduler_aux SchedulerClass;
+
+typedef struct scheduler_aux {
+    /* Properties */
+    class_t metadata;
+    GameboyClass *parent;
+    scheduler_context_t *context;
+    /* Methods */
+    void (*schedule)(SchedulerClass *, event_type_t, uint64_t);
+    void (*cancel)(SchedulerClass *, event_type_t);
+    bool (*pending)(SchedulerClass *, event_type_t);
+    uint64_t (*next)(SchedulerClass *);
+    uint64_t (*horizon)(SchedulerClass *, event_type_t);
+    void (*run)(SchedulerClass *, uint64_t);
+    void (*dispatch)(SchedulerClass *, event_type_t);
+} SchedulerClass;
+
+extern const class_t *Scheduler;
+#endif
@@ -13,6 +13,7 @@ typedef struct sound_aux {
     class_t metadata;
     GameboyClass *parent;
     const uint8_t duty_cycles[4];
+    const uint8_t duty_waveforms[4];
     const uint8_t volume_levels[4];
     sound_context_t *context;
     /* Methods */
@@ -20,14 +21,32 @@ typedef struct sound_aux {
     void (*write)(SoundClass *, uint16_t, uint8_t);
     void (*update)(SoundClass *);
     void (*audio_callback)(void *, uint8_t *, int32_t);
-    void (*update_channel1)(SoundClass *, float_t);
-    void (*update_channel2)(SoundClass *, float_t);
-    void (*update_channel3)(SoundClass *, float_t);
-    void (*update_channel4)(SoundClass *, float_t);
-    float_t (*get_channel1_sample)(SoundClass *);
-    float_t (*get_channel2_sample)(SoundClass *);
-    float_t (*get_channel3_sample)(SoundClass *);
-    float_t (*get_channel4_sample)(SoundClass *);
+    void (*mix)(SoundClass *, uint64_t);
+    void (*output)(SoundClass *, uint8_t, int32_t, uint64_t);
+    void (*add_delta)(SoundClass *, uint64_t, int32_t, int32_t);
+    void (*flush)(SoundClass *, uint64_t);
+    void (*push)(SoundClass *, const int16_t[AUDIO_CHANNELS]);
+    size_t (*pop)(SoundClass *, int16_t *, size_t);
+    void (*sync)(SoundClass *);
+    void (*sequence)(SoundClass *, uint64_t);
+    size_t (*buffered)(SoundClass *);
+    uint32_t (*played)(SoundClass *);
+    void (*trim)(SoundClass *, uint32_t);
+    void (*set_rate)(SoundClass *, double);
+    void (*schedule)(SoundClass *);
+    void (*tick)(SoundClass *);
+    void (*update_channel1)(SoundClass *, uint64_t);
+    void (*update_channel2)(SoundClass *, uint64_t);
+    void (*update_channel3)(SoundClass *, uint64_t);
+    void (*update_channel4)(SoundClass *, uint64_t);
+    uint16_t (*sweep_frequency)(SoundClass *);
+    void (*clock_sweep)(SoundClass *);
+    int32_t (*get_channel1_sample)(SoundClass *);
+    int32_t (*get_channel2_sample)(SoundClass *);
+    int32_t (*get_channel3_sample)(SoundClass *);
+    int32_t (*get_channel4_sample)(SoundClass *);
+    void (*init_kernel)(SoundClass *);
+    void (*init_lfsr)(SoundClass *);
     void (*init_sound_system)(SoundClass *);
     void (*update_volume)(SoundClass *, bool);
 } SoundClass;
@@ -0,0 +1,35 @@
+#include "common.h"
+#include "oop.h"
+
+#ifndef __STATE
+    #define __STATE
+
+typedef struct gameboy_aux GameboyClass;
+typedef struct state_aux StateClass;
+
+typedef void (*state_fn)(StateClass *, state_stream_t *);
+
+typedef struct {
+    uint32_t tag;
+    state_fn sync;
+} state_chunk_t;
+
+typedef struct state_aux {
+    /* Properties */
+    class_t metadata;
+    GameboyClass *parent;
+    state_context_t *context;
+    state_chunk_t chunks[STATE_CHUNKS];
+    /* Methods */
+    size_t (*size)(StateClass *);
+    size_t (*save)(StateClass *, uint8_t *, size_t);
+    size_t (*save_chunks)(StateClass *, uint8_t *, size_t, uint32_t);
+    bool (*load)(StateClass *, const uint8_t *, size_t);
+    bool (*save_file)(StateClass *, const char *);
+    bool (*load_file)(StateClass *, const char *);
+    void (*request)(StateClass *, state_request_t);
+    void (*service)(StateClass *);
+} StateClass;
+
+extern const class_t *State;
+#endif
@@ -12,8 +12,13 @@ typedef struct timer_aux {
     class_t metadata;
     timer_context_t *context;
     GameboyClass *parent;
+    const uint8_t bits[4];
     /* Methods */
     void (*tick)(TimerClass *);
+    bool (*signal)(TimerClass *);
+    void (*advance)(TimerClass *, uint64_t);
+    void (*sync)(TimerClass *);
+    void (*schedule)(TimerClass *);
     uint8_t (*read)(TimerClass *, uint16_t);
     void (*write)(TimerClass *, uint16_t, uint8_t);
 } TimerClass;
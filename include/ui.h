@@ -1,4 +1,6 @@
-#include <SDL2/SDL.h>
+#ifndef HEADLESS
+    #include <SDL2/SDL.h>
+#endif
 #include "common.h"
 #include "oop.h"
 
@@ -17,24 +19,28 @@ typedef struct ui_aux {
     int32_t scale;
     int32_t x;
     int32_t y;
-    uint64_t tile_colors[4];
+    uint32_t tile_colors[4];
+#ifndef HEADLESS
     SDL_Window *window;
     SDL_Renderer *renderer;
     SDL_Texture *texture;
-    SDL_Surface *screen;
     SDL_Window *debug_window;
     SDL_Renderer *debug_renderer;
     SDL_Texture *debug_texture;
     SDL_Surface *debug_screen;
+    int32_t debug_bank;
+#endif
     /* Methods */
-    void (*create_resources)(UIClass *);
     void (*handle_events)(UIClass *);
-    void (*update_debug_window)(UIClass *);
-    void (*display_tile)(UIClass *, uint16_t, int32_t, int32_t);
     void (*update)(UIClass *);
     uint32_t (*get_ticks)(void);
     void (*delay)(uint32_t);
+#ifndef HEADLESS
+    void (*create_resources)(UIClass *);
+    void (*update_debug_window)(UIClass *);
+    void (*display_tile)(UIClass *, uint16_t, int32_t, int32_t);
     void (*on_key)(UIClass *, bool, SDL_Keycode);
+#endif
 } UIClass;
 
 extern const class_t *UI;
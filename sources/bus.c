@@ -4,10 +4,93 @@ static void constructor(void *ptr, va_list *args)
 {
     BusClass *self = (BusClass *) ptr;
     self->parent = va_arg(*args, GameboyClass *);
+    if (!((self->context = calloc(1, sizeof(*self->context))))) {
+        HANDLE_ERROR("failed memory allocation");
+    }
+}
+
+static void destructor(void *ptr)
+{
+    BusClass *self = (BusClass *) ptr;
+    free(self->context);
+}
+
+static void map(BusClass *self, uint16_t start, uint16_t end,
+    const uint8_t *read, uint8_t *write)
+{
+    for (uint16_t page = start >> 8; page <= (end >> 8); page++) {
+        uint16_t offset = (page << 8) - start;
+        self->context->read_pages[page] = read ? read + offset : NULL;
+        self->context->write_pages[page] = write ? write + offset : NULL;
+    }
+}
+
+/*
+ * Rebuild the table of host pointers used by read/write for plain memory.
+ * Pages left NULL (I/O, OAM, MBC registers, disabled or special cartridge
+ * RAM) fall through to the range dispatch below. Must be called whenever
+ * a ROM, RAM, VRAM or WRAM bank changes.
+ */
+static void remap(BusClass *self)
+{
+    CartridgeClass *cartridge = self->parent->cartridge;
+    PPUClass *ppu = self->parent->ppu;
+    RAMClass *ram = self->parent->ram;
+    DMAClass *dma = self->parent->dma;
+
+    /* bytes due from the old mapping are copied before it goes away */
+    dma->sync(dma, self->parent->context->ticks);
+
+    memset(self->context, 0, sizeof(*self->context));
+
+    if (cartridge->context->rom_data) {
+        map(self, 0x0000, 0x3FFF, cartridge->rom_bank(cartridge, 0x0000),
+            NULL);
+        map(self, 0x4000, 0x7FFF, cartridge->rom_bank(cartridge, 0x4000),
+            NULL);
+        map(self, 0xA000, 0xBFFF, cartridge->ram_page(cartridge, false),
+            cartridge->ram_page(cartridge, true));
+    }
+
+    uint8_t *vram = ppu->context->vram + (ppu->context->vram_bank * 0x2000);
+    uint8_t *wram_0 = ram->context->wram;
+    uint8_t *wram_x = ram->context->wram + (ram->context->wram_bank * 0x1000);
+
+    /*
+     * VRAM writes must reach the PPU while a line is drawn lazily, and tile
+     * data writes always do so the PPU can track which tiles changed
+     */
+    map(self, 0x8000, 0x97FF, vram, NULL);
+    map(self, 0x9800, 0x9FFF, vram + 0x1800,
+        ppu->context->scanline_pending ? NULL : vram + 0x1800);
+    map(self, 0xC000, 0xCFFF, wram_0, wram_0);
+    map(self, 0xD000, 0xDFFF, wram_x, wram_x);
+    map(self, 0xE000, 0xEFFF, wram_0, wram_0);
+    map(self, 0xF000, 0xFDFF, wram_x, wram_x);
+
+    /*
+     * writes to a DMA source page must sync the transfer first, including
+     * writes through its echo RAM alias
+     */
+    if (dma->transferring(dma)) {
+        uint8_t source = dma->context->value;
+
+        self->context->write_pages[source] = NULL;
+        if (source >= 0xC0 && source <= 0xFD) {
+            self->context->write_pages[source ^ 0x20] = NULL;
+        }
+        dma->schedule(dma);
+    }
 }
 
 static uint8_t read(BusClass *self, uint16_t address)
 {
+    const uint8_t *page = self->context->read_pages[address >> 8];
+
+    if (page) {
+        return page[address & 0xFF];
+    }
+
     switch (address) {
         case ROM_RANGE: {
             return self->parent->cartridge->read(
@@ -56,10 +139,20 @@ static uint8_t read(BusClass *self, uint16_t address)
 
 static void write(BusClass *self, uint16_t address, uint8_t value)
 {
+    uint8_t *page = self->context->write_pages[address >> 8];
+
+    if (page) {
+        page[address & 0xFF] = value;
+        return;
+    }
+
+    self->parent->dma->sync(self->parent->dma, self->parent->context->ticks);
+
     switch (address) {
         case ROM_RANGE: {
             self->parent->cartridge->write(
                 self->parent->cartridge, address, value);
+            self->remap(self);
             break;
         }
         case CHAR_RANGE: {
@@ -130,12 +223,13 @@ const BusClass bus_init = {
         ._size = sizeof(BusClass),
         ._name = "Bus",
         ._constructor = constructor,
-        ._destructor = NULL,
+        ._destructor = destructor,
     },
     .read = read,
     .write = write,
     .read16 = read16,
     .write16 = write16,
+    .remap = remap,
 };
 
 const class_t *Bus = (const class_t *) &bus_init;
@@ -1,5 +1,95 @@
+#include <sys/stat.h>
 #include "../include/gameboy.h"
 
+/* ROM images are immutable and shared by every cartridge in the process */
+static rom_image_t *rom_images = NULL;
+static pthread_mutex_t rom_images_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static uint64_t rom_hash(const uint8_t *data, size_t size)
+{
+    uint64_t hash = 0xCBF29CE484222325ULL;
+
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ data[i]) * 0x100000001B3ULL;
+    }
+    return hash;
+}
+
+/* Caller holds rom_images_lock */
+static rom_image_t *find_image(
+    const char *path, time_t modified, uint32_t size)
+{
+    for (rom_image_t *image = rom_images; image; image = image->next) {
+        if (image->size == size && image->modified == modified
+            && !strcmp(image->path, path)) {
+            image->references++;
+            return image;
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Takes ownership of data. If the same bytes are already cached the copy
+ * is freed and the cached image is returned instead.
+ */
+static rom_image_t *share_image(
+    const char *path, time_t modified, uint8_t *data, uint32_t size)
+{
+    uint64_t hash = rom_hash(data, size);
+    rom_image_t *image = NULL;
+
+    pthread_mutex_lock(&rom_images_lock);
+
+    for (image = rom_images; image; image = image->next) {
+        if (image->size == size && image->hash == hash
+            && !memcmp(image->data, data, size)) {
+            image->references++;
+            free(data);
+            break;
+        }
+    }
+
+    if (!image) {
+        if (!((image = calloc(1, sizeof(*image))))) {
+            HANDLE_ERROR("failed memory allocation");
+        }
+        snprintf(image->path, sizeof(image->path), "%s", path);
+        image->modified = modified;
+        image->hash = hash;
+        image->size = size;
+        image->references = 1;
+        image->data = data;
+        image->next = rom_images;
+        rom_images = image;
+    }
+
+    pthread_mutex_unlock(&rom_images_lock);
+
+    return image;
+}
+
+static void release_image(rom_image_t *image)
+{
+    if (!image) {
+        return;
+    }
+
+    pthread_mutex_lock(&rom_images_lock);
+
+    if (--image->references == 0) {
+        rom_image_t **link = &rom_images;
+        while (*link != image) {
+            link = &(*link)->next;
+        }
+        *link = image->next;
+        free(image->data);
+        free(image);
+    }
+
+    pthread_mutex_unlock(&rom_images_lock);
+}
+
 static void constructor(void *ptr, va_list UNUSED *args)
 {
     CartridgeClass *self = (CartridgeClass *) ptr;
@@ -18,7 +108,7 @@ static void destructor(void *ptr)
         }
     }
 
-    free(self->context->rom_data);
+    release_image(self->context->image);
     free(self->context);
 }
 
@@ -36,40 +126,28 @@ static const char *get_rom_type(CartridgeClass *self)
         : "UNKNOWN";
 }
 
-static bool load(CartridgeClass *self, const char *path)
+static bool parse(CartridgeClass *self)
 {
-    strncpy(self->context->filename, path, sizeof(self->context->filename));
-    FILE *stream = fopen(path, "r");
-    if (!stream) {
-        fprintf(stderr, "Failed to open ROM (%s)\n", path);
+    if (self->context->rom_size < 0x150) {
+        fprintf(stderr, "ROM too small (%u bytes)\n", self->context->rom_size);
         return false;
     }
-    char opened_msg[256];
-    snprintf(opened_msg, sizeof(opened_msg), "Opened: %s", path);
-    LOG(opened_msg);
-    fseek(stream, 0, SEEK_END);
-    self->context->rom_size = ftell(stream);
-    rewind(stream);
-
-    if (!((self->context->rom_data = calloc(self->context->rom_size, 1)))) {
-        fclose(stream);
-        HANDLE_ERROR("failed memory allocation");
-    }
-    fread(self->context->rom_data, self->context->rom_size, 1, stream);
 
-    self->context->header = (rom_header_t *) (self->context->rom_data + 0x100);
-    self->context->header->title[14] = 0;
+    self->context->rom_data = self->context->image->data;
+    self->context->header =
+        (const rom_header_t *) (self->context->rom_data + 0x100);
+    memcpy(self->context->title, self->context->header->title, 14);
+    self->context->title[14] = 0;
     self->context->has_battery = self->battery(self);
     self->context->has_rtc = self->rtc(self);
     self->context->needs_save = false;
-    fclose(stream);
 
     char cart_msg[512];
 
     LOG("Cartridge loaded");
 
     snprintf(
-        cart_msg, sizeof(cart_msg), "Title: %s", self->context->header->title);
+        cart_msg, sizeof(cart_msg), "Title: %s", self->context->title);
     LOG(cart_msg);
 
     snprintf(cart_msg, sizeof(cart_msg), "Type: %2.2X (%s)",
@@ -110,23 +188,113 @@ static bool load(CartridgeClass *self, const char *path)
     return true;
 }
 
-static uint8_t read(CartridgeClass *self, uint16_t address)
+static bool load(CartridgeClass *self, const char *path)
+{
+    /* the context is zeroed, so the last byte keeps the name terminated */
+    strncpy(
+        self->context->filename, path, sizeof(self->context->filename) - 1);
+    struct stat info;
+    if (stat(path, &info) != 0) {
+        fprintf(stderr, "Failed to open ROM (%s)\n", path);
+        return false;
+    }
+    char opened_msg[256];
+    snprintf(opened_msg, sizeof(opened_msg), "Opened: %s", path);
+    LOG(opened_msg);
+    self->context->rom_size = info.st_size;
+
+    pthread_mutex_lock(&rom_images_lock);
+    self->context->image =
+        find_image(path, info.st_mtime, self->context->rom_size);
+    pthread_mutex_unlock(&rom_images_lock);
+
+    if (self->context->image) {
+        return parse(self);
+    }
+
+    FILE *stream = fopen(path, "r");
+    if (!stream) {
+        fprintf(stderr, "Failed to open ROM (%s)\n", path);
+        return false;
+    }
+
+    uint8_t *data = calloc(self->context->rom_size, 1);
+    if (!data) {
+        fclose(stream);
+        HANDLE_ERROR("failed memory allocation");
+    }
+    fread(data, self->context->rom_size, 1, stream);
+    fclose(stream);
+
+    self->context->image =
+        share_image(path, info.st_mtime, data, self->context->rom_size);
+
+    return parse(self);
+}
+
+static bool load_memory(CartridgeClass *self, const uint8_t *data, size_t size)
+{
+    /* no filename: battery RAM stays in memory and is never written out */
+    self->context->filename[0] = 0;
+    self->context->rom_size = size;
+
+    if (size < 0x150) {
+        fprintf(stderr, "ROM too small (%zu bytes)\n", size);
+        return false;
+    }
+
+    uint8_t *copy = malloc(size);
+    if (!copy) {
+        HANDLE_ERROR("failed memory allocation");
+    }
+    memcpy(copy, data, size);
+
+    self->context->image = share_image("", 0, copy, size);
+
+    return parse(self);
+}
+
+static const uint8_t *rom_bank(CartridgeClass *self, uint16_t address)
 {
     if (address < 0x4000) {
         if (self->mbc_1(self) && self->context->banking_mode == 1) {
             uint8_t rom_bank_mask = (self->context->rom_size / 0x4000) - 1;
             uint8_t bank =
                 (self->context->rom_bank_value & 0xE0) & rom_bank_mask;
-            return self->context->rom_data[(bank * 0x4000) + address];
+            return self->context->rom_data + (bank * 0x4000);
         }
-        return self->context->rom_data[address];
+        return self->context->rom_data;
+    }
+
+    if (self->context->rom_bank_x) {
+        return self->context->rom_bank_x;
+    }
+    return self->context->rom_data + 0x4000;
+}
+
+static uint8_t *ram_page(CartridgeClass *self, bool writing)
+{
+    if (!self->context->ram_enabled || self->context->ram_bank == NULL) {
+        return NULL;
+    }
+
+    if (self->mbc_2(self)
+        || (self->mbc_3(self) && self->context->rtc_selected)) {
+        return NULL;
+    }
+
+    /* battery backed writes must go through write() to flag needs_save */
+    if (writing && self->context->has_battery) {
+        return NULL;
     }
 
+    return self->context->ram_bank;
+}
+
+static uint8_t read(CartridgeClass *self, uint16_t address)
+{
     if (address < 0x8000) {
-        if (self->context->rom_bank_x) {
-            return self->context->rom_bank_x[address - 0x4000];
-        }
-        return self->context->rom_data[address];
+        return self->rom_bank(self, address)[address & 0x3FFF];
     }
 
     if ((address & 0xE000) == 0xA000) {
@@ -662,7 +830,7 @@ static void setup_banks(CartridgeClass *self)
 
 static void load_battery(CartridgeClass *self)
 {
-    if (self->context->ram_bank == NULL) {
+    if (self->context->ram_bank == NULL || !self->context->filename[0]) {
         return;
     }
 
@@ -701,7 +869,7 @@ static void load_battery(CartridgeClass *self)
 
 static void save_battery(CartridgeClass *self)
 {
-    if (self->context->ram_bank == NULL) {
+    if (self->context->ram_bank == NULL || !self->context->filename[0]) {
         return;
     }
 
@@ -851,8 +1019,11 @@ const CartridgeClass init_cartridge = {
     .get_license = get_license,
     .get_rom_type = get_rom_type,
     .load = load,
+    .load_memory = load_memory,
     .read = read,
     .write = write,
+    .rom_bank = rom_bank,
+    .ram_page = ram_page,
     .mbc_1 = mbc_1,
     .mbc_2 = mbc_2,
     .mbc_3 = mbc_3,
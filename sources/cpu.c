@@ -9,239 +9,95 @@ static void constructor(void *ptr, va_list *args)
     self->parent = va_arg(*args, GameboyClass *);
     self->context->registers.pc = 0x100;
     self->context->registers.sp = 0xFFFE;
-    *((int16_t *) &self->context->registers.a) = 0xB001;
-    *((int16_t *) &self->context->registers.b) = 0x1300;
-    *((int16_t *) &self->context->registers.d) = 0xD800;
-    *((int16_t *) &self->context->registers.h) = 0x4D01;
+    self->context->registers.af = 0x01B0;
+    self->context->registers.bc = 0x0013;
+    self->context->registers.de = 0x00D8;
+    self->context->registers.hl = 0x014D;
     self->context->int_master_enabled = false;
     self->context->enabling_ime = false;
     self->parent->timer->context->div = 0xABCC;
+
+    if (!((self->blocks = calloc(BLOCK_CACHE_SIZE, sizeof(block_t))))) {
+        HANDLE_ERROR("failed memory allocation");
+    }
+
+    InstructionsClass *instructions = self->parent->instructions;
+    for (uint32_t opcode = 0; opcode < 0x100; opcode++) {
+        self->operations[opcode] =
+            instructions->decode(instructions, self, opcode);
+        self->cb_operations[opcode] =
+            instructions->decode_cb(instructions, self, opcode);
+    }
 }
 
 static void destructor(void *ptr)
 {
     CPUClass *self = (CPUClass *) ptr;
+    free(self->blocks);
     free(self->context);
 }
 
-static void fetch_instructions(CPUClass *self)
-{
-    self->context->opcode = self->parent->bus->read(
-        self->parent->bus, self->get_registers(self)->pc++);
-    self->context->inst = self->parent->instructions->by_opcode(
-        self->parent->instructions, self->context->opcode);
-}
-
-static void fetch_data(CPUClass *self)
+/*
+ * ALU ops only record their operands; F is rebuilt from the last of them
+ * the first time something actually reads it.
+ */
+static uint8_t flags(CPUClass *self)
 {
-    self->context->mem_dest = 0;
-    self->context->dest_is_mem = false;
-
-    if (self->context->inst == NULL) {
-        return;
-    }
-    switch (self->context->inst->mode) {
-        case AM_IMP: break;
-        case AM_R: {
-            self->context->fetched_data =
-                self->read_register(self, self->context->inst->register_1);
-            break;
-        }
-        case AM_R_R: {
-            self->context->fetched_data =
-                self->read_register(self, self->context->inst->register_2);
-            break;
-        }
-        case AM_R_D8: {
-            self->context->fetched_data = self->parent->bus->read(
-                self->parent->bus, self->context->registers.pc);
-            self->parent->cycles(self->parent, 1);
-            self->context->registers.pc++;
+    lazy_flags_t *lazy = &self->context->lazy;
+    int32_t x = lazy->x;
+    int32_t y = lazy->y;
+    int32_t carry = lazy->carry;
+    bool z, n, h, c;
+
+    switch (lazy->op) {
+        case LAZY_ADD: {
+            z = ((x + y + carry) & 0xFF) == 0;
+            n = false;
+            h = (x & 0xF) + (y & 0xF) + carry > 0xF;
+            c = x + y + carry > 0xFF;
             break;
         }
-        case AM_R_D16:
-        case AM_D16: {
-            uint16_t lo = self->parent->bus->read(
-                self->parent->bus, self->context->registers.pc);
-            self->parent->cycles(self->parent, 1);
-            uint16_t hi = self->parent->bus->read(
-                self->parent->bus, self->context->registers.pc + 1);
-            self->parent->cycles(self->parent, 1);
-            self->context->fetched_data = lo | (hi << 8);
-            self->context->registers.pc += 2;
-            break;
-        }
-        case AM_MR_R: {
-            self->context->fetched_data =
-                self->read_register(self, self->context->inst->register_2);
-            self->context->mem_dest =
-                self->read_register(self, self->context->inst->register_1);
-            self->context->dest_is_mem = true;
-            if (self->context->inst->register_1 == RT_C) {
-                self->context->mem_dest |= 0xFF00;
-            }
-            break;
-        }
-        case AM_R_MR: {
-            uint16_t address =
-                self->read_register(self, self->context->inst->register_2);
-            if (self->context->inst->register_2 == RT_C) {
-                address |= 0xFF00;
-            }
-            self->context->fetched_data =
-                self->parent->bus->read(self->parent->bus, address);
-            self->parent->cycles(self->parent, 1);
-            break;
-        }
-        case AM_R_HLI: {
-            uint16_t address =
-                self->read_register(self, self->context->inst->register_2);
-            self->context->fetched_data =
-                self->parent->bus->read(self->parent->bus, address);
-            self->parent->cycles(self->parent, 1);
-            self->set_register(
-                self, RT_HL, self->read_register(self, RT_HL) + 1);
-            break;
-        }
-        case AM_R_HLD: {
-            uint16_t address =
-                self->read_register(self, self->context->inst->register_2);
-            self->context->fetched_data =
-                self->parent->bus->read(self->parent->bus, address);
-            self->parent->cycles(self->parent, 1);
-            self->set_register(
-                self, RT_HL, self->read_register(self, RT_HL) - 1);
-            break;
-        }
-        case AM_HLI_R: {
-            self->context->fetched_data =
-                self->read_register(self, self->context->inst->register_2);
-            self->context->mem_dest =
-                self->read_register(self, self->context->inst->register_1);
-            self->context->dest_is_mem = true;
-            self->set_register(
-                self, RT_HL, self->read_register(self, RT_HL) + 1);
-            break;
-        }
-        case AM_HLD_R: {
-            self->context->fetched_data =
-                self->read_register(self, self->context->inst->register_2);
-            self->context->mem_dest =
-                self->read_register(self, self->context->inst->register_1);
-            self->context->dest_is_mem = true;
-            self->set_register(
-                self, RT_HL, self->read_register(self, RT_HL) - 1);
-            break;
-        }
-        case AM_R_A8: {
-            self->context->fetched_data = self->parent->bus->read(
-                self->parent->bus, self->context->registers.pc);
-            self->parent->cycles(self->parent, 1);
-            self->context->registers.pc++;
+        case LAZY_SUB: {
+            z = ((x - y - carry) & 0xFF) == 0;
+            n = true;
+            h = (x & 0xF) - (y & 0xF) - carry < 0;
+            c = x - y - carry < 0;
             break;
         }
-        case AM_A8_R: {
-            self->context->mem_dest =
-                self->parent->bus->read(
-                    self->parent->bus, self->context->registers.pc)
-                | 0xFF00;
-            self->context->dest_is_mem = true;
-            self->parent->cycles(self->parent, 1);
-            self->context->registers.pc++;
+        case LAZY_AND:
+        case LAZY_OR: {
+            z = x == 0;
+            n = false;
+            h = lazy->op == LAZY_AND;
+            c = false;
             break;
         }
-        case AM_HL_SPR: {
-            self->context->fetched_data = self->parent->bus->read(
-                self->parent->bus, self->context->registers.pc);
-            self->parent->cycles(self->parent, 1);
-            self->context->registers.pc++;
+        case LAZY_INC: {
+            z = x == 0;
+            n = false;
+            h = (x & 0x0F) == 0;
+            c = carry;
             break;
         }
-        case AM_D8: {
-            self->context->fetched_data = self->parent->bus->read(
-                self->parent->bus, self->context->registers.pc);
-            self->parent->cycles(self->parent, 1);
-            self->context->registers.pc++;
+        case LAZY_DEC: {
+            z = x == 0;
+            n = true;
+            h = (x & 0x0F) == 0x0F;
+            c = carry;
             break;
         }
-        case AM_A16_R:
-        case AM_D16_R: {
-            uint16_t lo = self->parent->bus->read(
-                self->parent->bus, self->context->registers.pc);
-            self->parent->cycles(self->parent, 1);
-            uint16_t hi = self->parent->bus->read(
-                self->parent->bus, self->context->registers.pc + 1);
-            self->parent->cycles(self->parent, 1);
-            self->context->dest_is_mem = true;
-            self->context->mem_dest = lo | (hi << 8);
-            self->context->fetched_data =
-                self->read_register(self, self->context->inst->register_2);
-            self->context->registers.pc += 2;
-            break;
-        }
-        case AM_MR_D8: {
-            self->context->fetched_data = self->parent->bus->read(
-                self->parent->bus, self->context->registers.pc);
-            self->parent->cycles(self->parent, 1);
-            self->context->registers.pc++;
-            self->context->dest_is_mem = true;
-            self->context->mem_dest =
-                self->read_register(self, self->context->inst->register_1);
-            break;
-        }
-        case AM_MR: {
-            uint16_t address =
-                self->read_register(self, self->context->inst->register_1);
-            self->context->fetched_data =
-                self->parent->bus->read(self->parent->bus, address);
-            self->context->dest_is_mem = true;
-            self->context->mem_dest =
-                self->read_register(self, self->context->inst->register_1);
-            self->parent->cycles(self->parent, 1);
-            break;
-        }
-        case AM_R_A16: {
-            uint16_t lo = self->parent->bus->read(
-                self->parent->bus, self->context->registers.pc);
-            self->parent->cycles(self->parent, 1);
-            uint16_t hi = self->parent->bus->read(
-                self->parent->bus, self->context->registers.pc + 1);
-            self->parent->cycles(self->parent, 1);
-            uint16_t address = lo | (hi << 8);
-            self->context->fetched_data =
-                self->parent->bus->read(self->parent->bus, address);
-            self->context->registers.pc += 2;
-            self->parent->cycles(self->parent, 1);
-            break;
-        }
-        default: {
-            char buff[64];
-            snprintf(buff, sizeof(buff),
-                "Unknown Addressing Mode! %d (%02X)\n",
-                self->context->inst->mode, self->context->opcode);
-            HANDLE_ERROR(buff);
-        }
+        default: return self->context->registers.f;
     }
-}
-
-static void execute(CPUClass *self)
-{
-    proc_fn proc = self->parent->instructions->get_proc(
-        self->parent->instructions, self->context->inst->type);
+    self->context->registers.f = (z << 7) | (n << 6) | (h << 5) | (c << 4);
+    lazy->op = LAZY_NONE;
 
-    if (!proc) {
-        HANDLE_ERROR("not implemented");
-    }
-    proc(self);
-}
-
-static uint16_t reverse(uint16_t n)
-{
-    return ((n & 0xFF00) >> 8) | ((n & 0x00FF) << 8);
+    return self->context->registers.f;
 }
 
 static void set_flags(CPUClass *self, char z, char n, char h, char c)
 {
+    self->flags(self);
+
     if (z != -1) {
         BIT_SET(self->context->registers.f, 7, z);
     }
@@ -256,27 +112,11 @@ static void set_flags(CPUClass *self, char z, char n, char h, char c)
     }
 }
 
-static bool check_condition(CPUClass *self)
-{
-    bool z = BIT(self->context->registers.f, 7);
-    bool c = BIT(self->context->registers.f, 4);
-
-    switch (self->context->inst->condition) {
-        case CT_NONE: return true;
-        case CT_C: return c;
-        case CT_NC: return !c;
-        case CT_Z: return z;
-        case CT_NZ: return !z;
-    }
-
-    return false;
-}
-
 static uint16_t read_register(CPUClass *self, register_type_t type)
 {
     switch (type) {
         case RT_A: return self->context->registers.a;
-        case RT_F: return self->context->registers.f;
+        case RT_F: return self->flags(self);
         case RT_B: return self->context->registers.b;
         case RT_C: return self->context->registers.c;
         case RT_D: return self->context->registers.d;
@@ -284,13 +124,11 @@ static uint16_t read_register(CPUClass *self, register_type_t type)
         case RT_H: return self->context->registers.h;
         case RT_L: return self->context->registers.l;
         case RT_AF:
-            return self->reverse(*((uint16_t *) &self->context->registers.a));
-        case RT_BC:
-            return self->reverse(*((uint16_t *) &self->context->registers.b));
-        case RT_DE:
-            return self->reverse(*((uint16_t *) &self->context->registers.d));
-        case RT_HL:
-            return self->reverse(*((uint16_t *) &self->context->registers.h));
+            self->flags(self);
+            return self->context->registers.af;
+        case RT_BC: return self->context->registers.bc;
+        case RT_DE: return self->context->registers.de;
+        case RT_HL: return self->context->registers.hl;
         case RT_PC: return self->context->registers.pc;
         case RT_SP: return self->context->registers.sp;
         default: return 0;
@@ -301,7 +139,10 @@ static void set_register(CPUClass *self, register_type_t type, uint16_t val)
 {
     switch (type) {
         case RT_A: self->context->registers.a = val & 0xFF; break;
-        case RT_F: self->context->registers.f = val & 0xF0; break;
+        case RT_F:
+            self->context->registers.f = val & 0xF0;
+            self->context->lazy.op = LAZY_NONE;
+            break;
         case RT_B: self->context->registers.b = val & 0xFF; break;
         case RT_C: self->context->registers.c = val & 0xFF; break;
         case RT_D: self->context->registers.d = val & 0xFF; break;
@@ -310,17 +151,12 @@ static void set_register(CPUClass *self, register_type_t type, uint16_t val)
         case RT_L: self->context->registers.l = val & 0xFF; break;
 
         case RT_AF:
-            *((uint16_t *) &self->context->registers.a) = self->reverse(val);
-            break;
-        case RT_BC:
-            *((uint16_t *) &self->context->registers.b) = self->reverse(val);
-            break;
-        case RT_DE:
-            *((uint16_t *) &self->context->registers.d) = self->reverse(val);
-            break;
-        case RT_HL:
-            *((uint16_t *) &self->context->registers.h) = self->reverse(val);
+            self->context->registers.af = val;
+            self->context->lazy.op = LAZY_NONE;
             break;
+        case RT_BC: self->context->registers.bc = val; break;
+        case RT_DE: self->context->registers.de = val; break;
+        case RT_HL: self->context->registers.hl = val; break;
 
         case RT_PC: self->context->registers.pc = val; break;
         case RT_SP: self->context->registers.sp = val; break;
@@ -328,40 +164,183 @@ static void set_register(CPUClass *self, register_type_t type, uint16_t val)
     }
 }
 
-static uint8_t read_register8(CPUClass *self, register_type_t reg)
+/*
+ * Only a scheduled event can raise IF, so a halted CPU sleeps straight to
+ * the M-cycle that dispatches the next one instead of stepping through the
+ * gap. With nothing scheduled it sleeps a scanline at a time.
+ */
+static int32_t idle_cycles(CPUClass *self)
 {
-    switch (reg) {
-        case RT_A: return self->context->registers.a;
-        case RT_F: return self->context->registers.f;
-        case RT_B: return self->context->registers.b;
-        case RT_C: return self->context->registers.c;
-        case RT_D: return self->context->registers.d;
-        case RT_E: return self->context->registers.e;
-        case RT_H: return self->context->registers.h;
-        case RT_L: return self->context->registers.l;
-        case RT_HL:
-            return self->parent->bus->read(
-                self->parent->bus, self->read_register(self, RT_HL));
-        default: HANDLE_ERROR("Invalid register read");
+    uint64_t ticks = self->parent->context->ticks;
+    uint64_t next = self->parent->scheduler->next(self->parent->scheduler);
+    int32_t t_cycles = self->parent->context->double_speed ? 2 : 4;
+    int32_t limit = TICKS_PER_LINE / t_cycles;
+
+    if (self->context->int_flags || next <= ticks) {
+        return 1;
     }
+
+    uint64_t count = (next - ticks + t_cycles - 1) / t_cycles;
+
+    return count < (uint64_t) limit ? (int32_t) count : limit;
 }
 
-static void set_register8(CPUClass *self, register_type_t reg, uint8_t val)
+/*
+ * Opt-in: called after a taken backwards JR. "JR self" and the usual
+ * "LDH A,(LY|STAT); CP|AND d8; JR cc" poll redo the same iteration until
+ * an event changes what they read, so every iteration that completes before
+ * the next scheduled event is skipped at once. Registers end up exactly as
+ * the last of them would leave them.
+ */
+static void skip_idle(CPUClass *self, const operation_t *op, int8_t offset)
 {
-    switch (reg) {
-        case RT_A: self->context->registers.a = val & 0xFF; break;
-        case RT_F: self->context->registers.f = val & 0xF0; break;
-        case RT_B: self->context->registers.b = val & 0xFF; break;
-        case RT_C: self->context->registers.c = val & 0xFF; break;
-        case RT_D: self->context->registers.d = val & 0xFF; break;
-        case RT_E: self->context->registers.e = val & 0xFF; break;
-        case RT_H: self->context->registers.h = val & 0xFF; break;
-        case RT_L: self->context->registers.l = val & 0xFF; break;
-        case RT_HL:
-            self->parent->bus->write(
-                self->parent->bus, self->read_register(self, RT_HL), val);
+    BusClass *bus = self->parent->bus;
+    uint16_t pc = self->context->registers.pc;
+    uint64_t ticks = self->parent->context->ticks;
+    uint64_t next = self->parent->scheduler->next(self->parent->scheduler);
+    int32_t t_cycles = self->parent->context->double_speed ? 2 : 4;
+    uint8_t port = 0;
+    uint8_t alu = 0;
+    uint8_t operand = 0;
+    uint32_t length;
+
+    /* a pending HDMA or speed switch stall must run first, as in run_block */
+    if (self->parent->context->stop_cycles_remaining
+        || self->context->enabling_ime
+        || (self->context->int_master_enabled
+            && (self->context->int_flags & self->context->ie_register))) {
+        return;
+    }
+
+    if (offset == -2) {
+        /* taken JR */
+        length = 3;
+    } else if (offset == -6 && bus->read(bus, pc) == 0xF0) {
+        /* LDH A,(a8) + CP/AND d8 + taken JR */
+        port = bus->read(bus, pc + 1);
+        alu = bus->read(bus, pc + 2);
+        operand = bus->read(bus, pc + 3);
+        length = 8;
+        if ((port != 0x41 && port != 0x44) || (alu != 0xFE && alu != 0xE6)) {
+            return;
+        }
+    } else {
+        return;
+    }
+
+    if (next <= ticks) {
+        return;
+    }
+
+    uint64_t iterations = (next - ticks - 1) / (length * t_cycles);
+    uint64_t limit = (TICKS_PER_LINE * LINES_PER_FRAME) / length;
+
+    if (iterations > limit) {
+        iterations = limit;
+    }
+    if (!iterations) {
+        return;
+    }
+
+    if (offset == -6) {
+        uint8_t value = bus->read(bus, 0xFF00 | port);
+        lazy_flags_t lazy = {.op = LAZY_SUB, .x = value, .y = operand};
+
+        if (alu == 0xE6) {
+            value &= operand;
+            lazy = (lazy_flags_t) {.op = LAZY_AND, .x = value};
+        }
+
+        /* Z and C are all a JR condition can test */
+        bool z = alu == 0xE6 ? value == 0 : value == operand;
+        bool c = alu == 0xFE && value < operand;
+        uint8_t f = (z << 7) | (c << 4);
+
+        if (op->mask && (f & op->mask) != op->flags) {
+            return;
+        }
+        self->context->registers.a = value;
+        self->context->lazy = lazy;
+    }
+
+    self->parent->cycles(self->parent, iterations * length);
+}
+
+/*
+ * ROM never changes under a given mapping, so straight-line code is decoded
+ * once per (host page, PC). Blocks stay within one 256 byte page, which
+ * makes the page pointer alone identify the bank they were read from; a
+ * bank switch simply stops matching.
+ */
+static const block_t *block(CPUClass *self, uint16_t pc)
+{
+    InstructionsClass *instructions = self->parent->instructions;
+    const uint8_t *page = self->parent->bus->context->read_pages[pc >> 8];
+
+    if (pc >= 0x8000 || !page) {
+        return NULL;
+    }
+
+    block_t *block = &self->blocks[(pc ^ ((uintptr_t) page >> 12))
+        & (BLOCK_CACHE_SIZE - 1)];
+
+    if (block->length && block->page == page && block->addresses[0] == pc) {
+        return block;
+    }
+
+    block->page = page;
+    block->length = 0;
+
+    uint16_t address = pc;
+    do {
+        uint8_t opcode = page[address & 0xFF];
+
+        block->addresses[block->length] = address;
+        block->operations[block->length++] = &self->operations[opcode];
+        if (instructions->branches(instructions, opcode)) {
             break;
-        default: HANDLE_ERROR("Invalid register set");
+        }
+        address += instructions->length(instructions, opcode);
+    } while (block->length < BLOCK_MAX_OPS && (address >> 8) == (pc >> 8));
+
+    return block;
+}
+
+/*
+ * Executes a block for as long as that is indistinguishable from calling
+ * step() per instruction: it returns at the first boundary where an
+ * interrupt is due, IME is pending, the CPU halted or stopped, a frame
+ * completed, the page was remapped or the PC left the decoded path.
+ */
+static void run_block(CPUClass *self, const block_t *block)
+{
+    cpu_context_t *context = self->context;
+    const uint8_t **pages = self->parent->bus->context->read_pages;
+    uint32_t frame = self->parent->ppu->context->current_frame;
+    uint8_t i = 0;
+
+    while (true) {
+        const operation_t *operation = block->operations[i];
+
+        context->opcode = operation - self->operations;
+        context->registers.pc++;
+        self->parent->cycles(self->parent, 1);
+#ifdef __CPU_DEBUG
+        self->parent->debug->cpu_step(
+            self->parent->debug, block->addresses[i]);
+#endif
+        operation->handler(self, operation);
+
+        if (++i == block->length
+            || context->registers.pc != block->addresses[i]
+            || pages[context->registers.pc >> 8] != block->page
+            || context->halted || context->enabling_ime
+            || (context->int_master_enabled
+                && (context->int_flags & context->ie_register))
+            || self->parent->context->stop_cycles_remaining
+            || self->parent->ppu->context->current_frame != frame) {
+            return;
+        }
     }
 }
 
@@ -372,25 +351,26 @@ static bool step(CPUClass *self)
         self->parent->context->stop_cycles_remaining -= 1;
         return true;
     }
-    if (!self->context->halted) {
+    const block_t *block = NULL;
+
+    if (!self->context->halted
+        && ((block = self->block(self, self->context->registers.pc)))) {
+        self->run_block(self, block);
+    } else if (!self->context->halted) {
 #ifdef __CPU_DEBUG
         uint16_t pc = self->context->registers.pc;
 #endif
-        self->fetch_instructions(self);
+        self->context->opcode = self->parent->bus->read(
+            self->parent->bus, self->context->registers.pc++);
         self->parent->cycles(self->parent, 1);
-        self->fetch_data(self);
 #ifdef __CPU_DEBUG
         self->parent->debug->cpu_step(self->parent->debug, pc);
 #endif
-        if (self->context->inst == NULL) {
-            char buff[64];
-            snprintf(buff, sizeof(buff), "Unknown Instruction! %02X\n",
-                self->context->opcode);
-            HANDLE_ERROR(buff);
-        }
-        self->execute(self);
+        const operation_t *operation =
+            &self->operations[self->context->opcode];
+        operation->handler(self, operation);
     } else {
-        self->parent->cycles(self->parent, 1);
+        self->parent->cycles(self->parent, self->idle_cycles(self));
         if (self->context->int_flags) {
             self->context->halted = false;
         }
@@ -480,9 +460,13 @@ static void request_interrupt(CPUClass *self, interrupt_t type)
 
 static void pretty_instruction(CPUClass *self, char buff[INST_BUFF_LEN])
 {
-    instruction_t *instruction = self->context->inst;
+    instruction_t *instruction = self->parent->instructions->by_opcode(
+        self->parent->instructions, self->context->opcode);
     char *instruction_name = self->parent->instructions->lookup(
         self->parent->instructions, instruction->type);
+    uint16_t pc = self->context->registers.pc;
+    uint16_t operand = self->parent->bus->read(self->parent->bus, pc)
+        | (self->parent->bus->read(self->parent->bus, pc + 1) << 8);
 
     switch (instruction->mode) {
         case AM_IMP:
@@ -491,7 +475,7 @@ static void pretty_instruction(CPUClass *self, char buff[INST_BUFF_LEN])
         case AM_R_D16:
         case AM_R_A16:
             snprintf(buff, INST_BUFF_LEN, "%s %s,$%04X", instruction_name,
-                LOOKUP_REG1, self->context->fetched_data);
+                LOOKUP_REG1, operand);
             break;
         case AM_R:
             snprintf(
@@ -516,7 +500,7 @@ static void pretty_instruction(CPUClass *self, char buff[INST_BUFF_LEN])
         case AM_R_D8:
         case AM_R_A8:
             snprintf(buff, INST_BUFF_LEN, "%s %s,$%02X", instruction_name,
-                LOOKUP_REG1, self->context->fetched_data & 0xFF);
+                LOOKUP_REG1, operand & 0xFF);
             break;
         case AM_R_HLI:
             snprintf(buff, INST_BUFF_LEN, "%s %s,(%s+)", instruction_name,
@@ -536,29 +520,27 @@ static void pretty_instruction(CPUClass *self, char buff[INST_BUFF_LEN])
             break;
         case AM_A8_R:
             snprintf(buff, INST_BUFF_LEN, "%s $%02X,%s", instruction_name,
-                self->parent->bus->read(
-                    self->parent->bus, self->context->registers.pc - 1),
-                LOOKUP_REG2);
+                operand & 0xFF, LOOKUP_REG2);
             break;
         case AM_HL_SPR:
             snprintf(buff, INST_BUFF_LEN, "%s (%s),SP+%d", instruction_name,
-                LOOKUP_REG1, self->context->fetched_data & 0xFF);
+                LOOKUP_REG1, operand & 0xFF);
             break;
         case AM_D8:
             snprintf(buff, INST_BUFF_LEN, "%s $%02X", instruction_name,
-                self->context->fetched_data & 0xFF);
+                operand & 0xFF);
             break;
         case AM_D16:
             snprintf(buff, INST_BUFF_LEN, "%s $%04X", instruction_name,
-                self->context->fetched_data);
+                operand);
             break;
         case AM_MR_D8:
             snprintf(buff, INST_BUFF_LEN, "%s (%s),$%02X", instruction_name,
-                LOOKUP_REG1, self->context->fetched_data & 0xFF);
+                LOOKUP_REG1, operand & 0xFF);
             break;
         case AM_A16_R:
             snprintf(buff, INST_BUFF_LEN, "%s ($%04X),%s", instruction_name,
-                self->context->fetched_data, LOOKUP_REG2);
+                operand, LOOKUP_REG2);
             break;
         default: {
             HANDLE_ERROR("Invalid Addressing Mode");
@@ -603,20 +585,18 @@ const CPUClass init_CPU = {
             "PC",
         },
     .step = step,
+    .block = block,
+    .run_block = run_block,
+    .idle_cycles = idle_cycles,
+    .skip_idle = skip_idle,
     .set_flags = set_flags,
-    .fetch_instructions = fetch_instructions,
-    .fetch_data = fetch_data,
-    .execute = execute,
-    .reverse = reverse,
+    .flags = flags,
     .read_register = read_register,
-    .check_condition = check_condition,
     .set_register = set_register,
     .set_ie_register = set_ie_register,
     .get_ie_register = get_ie_register,
     .get_registers = get_registers,
     .is_16bit = is_16bit,
-    .read_register8 = read_register8,
-    .set_register8 = set_register8,
     .decode_register = decode_register,
     .int_handle = int_handle,
     .int_check = int_check,
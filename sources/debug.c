@@ -27,13 +27,12 @@ static void print(DebugClass *self)
 static void cpu_step(DebugClass *self, uint16_t pc)
 {
     CPUClass *cpu = self->parent->cpu;
+    uint8_t f = cpu->flags(cpu);
 
     char flags[16];
-    snprintf(flags, sizeof(flags), "%c%c%c%c",
-        cpu->context->registers.f & (1 << 7) ? 'Z' : '-',
-        cpu->context->registers.f & (1 << 6) ? 'N' : '-',
-        cpu->context->registers.f & (1 << 5) ? 'H' : '-',
-        cpu->context->registers.f & (1 << 4) ? 'C' : '-');
+    snprintf(flags, sizeof(flags), "%c%c%c%c", f & (1 << 7) ? 'Z' : '-',
+        f & (1 << 6) ? 'N' : '-', f & (1 << 5) ? 'H' : '-',
+        f & (1 << 4) ? 'C' : '-');
 
     cpu->pretty_instruction(cpu, self->instruction_data);
 
@@ -41,7 +40,8 @@ static void cpu_step(DebugClass *self, uint16_t pc)
         "%08llX - %04X: %-12s (%02X %02X %02X) A: %02X F: %s BC: %02X%02X "
         "DE: %02X%02X "
         "HL: %02X%02X\n",
-        cpu->parent->context->ticks, pc, self->instruction_data,
+        (unsigned long long) cpu->parent->context->ticks, pc,
+        self->instruction_data,
         cpu->context->opcode, cpu->parent->bus->read(cpu->parent->bus, pc + 1),
         cpu->parent->bus->read(cpu->parent->bus, pc + 2),
         cpu->context->registers.a, flags, cpu->context->registers.b,
@@ -17,28 +17,101 @@ static void destructor(void *ptr)
 
 static void start(DMAClass *self, uint8_t value)
 {
+    self->sync(self, self->parent->context->ticks);
+
     self->context->byte = 0;
     self->context->active = true;
     self->context->start_delay = 2;
     self->context->value = value;
+    self->context->base = self->parent->context->ticks;
+    self->parent->bus->remap(self->parent->bus);
+    self->schedule(self);
 }
 
-static void tick(DMAClass *self)
+/*
+ * A source in plain memory is copied lazily, so only the end of the
+ * transfer needs an event. Anything else (I/O, OAM, MBC registers) still
+ * has to be read on the M-cycle its byte is due.
+ */
+static void schedule(DMAClass *self)
 {
+    int32_t t_cycles = self->parent->context->double_speed ? 2 : 4;
+    uint32_t steps = 1;
+
     if (!self->context->active) {
+        self->parent->scheduler->cancel(self->parent->scheduler, EV_DMA);
         return;
     }
-    if (self->context->start_delay) {
-        self->context->start_delay -= 1;
+
+    if (self->parent->bus->context->read_pages[self->context->value]) {
+        steps = self->context->start_delay + (0xA0 - self->context->byte);
+    }
+
+    self->parent->scheduler->schedule(self->parent->scheduler, EV_DMA,
+        self->context->base + ((uint64_t) steps * t_cycles));
+}
+
+/*
+ * Catches up with every M-cycle due by the given tick: the start delay
+ * first, then one byte each. A mapped source is copied straight from the
+ * page; the CPU cannot write to it without syncing first, since the bus
+ * keeps that page unmapped for writes while a transfer runs.
+ */
+static void sync(DMAClass *self, uint64_t until)
+{
+    dma_context_t *context = self->context;
+    int32_t t_cycles = self->parent->context->double_speed ? 2 : 4;
+
+    if (!context->active || until < context->base + t_cycles) {
         return;
     }
-    self->parent->ppu->oam_write(self->parent->ppu, self->context->byte,
-        self->parent->bus->read(self->parent->bus,
-            (self->context->value * 0x100) + self->context->byte));
 
-    self->context->byte += 1;
+    uint64_t steps = (until - context->base) / t_cycles;
+    uint32_t delay = context->start_delay;
+    uint32_t count = 0xA0 - context->byte;
+
+    context->base += steps * t_cycles;
+    if (steps < delay) {
+        delay = steps;
+    }
+    context->start_delay -= delay;
+    steps -= delay;
+    if (steps < count) {
+        count = steps;
+    }
+
+    const uint8_t *page =
+        self->parent->bus->context->read_pages[context->value];
+    uint8_t *oam = (uint8_t *) self->parent->ppu->context->oam_ram;
+
+    if (page) {
+        memcpy(oam + context->byte, page + context->byte, count);
+    } else {
+        for (uint32_t i = 0; i < count; i++) {
+            oam[context->byte + i] = self->parent->bus->read(self->parent->bus,
+                (context->value * 0x100) + context->byte + i);
+        }
+    }
+    context->byte += count;
+    context->active = context->byte < 0xA0;
+}
+
+static void tick(DMAClass *self)
+{
+    self->sync(self, self->parent->context->ticks);
 
-    self->context->active = self->context->byte < 0xA0;
+    if (!self->context->active) {
+        self->parent->bus->remap(self->parent->bus);
+        return;
+    }
+    self->schedule(self);
+}
+
+/* A speed switch keeps what was copied and restarts the M-cycle clock */
+static void retime(DMAClass *self)
+{
+    self->context->base = self->parent->context->ticks;
+    self->schedule(self);
 }
 
 static bool transferring(DMAClass *self)
@@ -55,6 +128,9 @@ const DMAClass init_dma = {
     },
     .start = start,
     .tick = tick,
+    .sync = sync,
+    .schedule = schedule,
+    .retime = retime,
     .transferring = transferring,
 };
 
@@ -1,3 +1,4 @@
+#define _POSIX_C_SOURCE 199309L
 #ifdef __EMSCRIPTEN__
     #include <emscripten.h>
 #endif
@@ -6,9 +7,14 @@
 static void constructor(void *ptr, va_list UNUSED *args)
 {
     GameboyClass *self = (GameboyClass *) ptr;
+    if (!((self->context = calloc(1, sizeof(*self->context))))) {
+        HANDLE_ERROR("failed memory allocation");
+    }
+    self->scheduler = new_class(Scheduler, self);
     self->cartridge = new_class(Cartridge);
     self->ram = new_class(RAM);
     self->instructions = new_class(Instructions);
+    self->planar = new_class(Planar);
     self->bus = new_class(Bus, self);
     self->timer = new_class(Timer, self);
     self->cpu = new_class(CPU, self);
@@ -17,14 +23,14 @@ static void constructor(void *ptr, va_list UNUSED *args)
     self->io = new_class(IO, self);
     self->debug = new_class(Debug, self);
     self->lcd = new_class(LCD, self);
-    self->ppu = new_class(PPU, self, FPS);
+    self->ppu = new_class(PPU, self);
     self->dma = new_class(DMA, self);
     self->pipeline = new_class(Pipeline, self);
     self->joypad = new_class(Joypad, self);
     self->sound = new_class(Sound, self);
-    if (!((self->context = calloc(1, sizeof(*self->context))))) {
-        HANDLE_ERROR("failed memory allocation");
-    }
+    self->pacer = new_class(Pacer, self);
+    self->state = new_class(State, self);
+    self->rewind = new_class(Rewind, self);
 }
 
 static void destructor(void *ptr)
@@ -41,14 +47,53 @@ static void destructor(void *ptr)
     destroy_class(self->debug);
     destroy_class(self->timer);
     destroy_class(self->pipeline);
+    destroy_class(self->planar);
     destroy_class(self->ppu);
     destroy_class(self->dma);
     destroy_class(self->lcd);
     destroy_class(self->joypad);
     destroy_class(self->sound);
+    destroy_class(self->scheduler);
+    destroy_class(self->pacer);
+    destroy_class(self->state);
+    destroy_class(self->rewind);
     free(self->context);
 }
 
+static void boot(GameboyClass *self)
+{
+    if (self->cartridge->context->header->cgb_flag & 0x80) {
+        self->context->hw_mode = HW_CGB;
+        self->cpu->context->registers.a = 0x11;
+        LOG("Running in CGB mode");
+    } else {
+        self->context->hw_mode = HW_DMG;
+        self->cpu->context->registers.a = 0x01;
+        LOG("Running in DMG mode");
+    }
+
+    self->bus->remap(self->bus);
+}
+
+static uint32_t run_frames(GameboyClass *self, uint32_t count)
+{
+    uint32_t start = self->ppu->context->current_frame;
+
+    self->context->running = true;
+
+    while (self->ppu->context->current_frame - start < count) {
+        if (self->context->die) {
+            break;
+        }
+        if (!self->cpu->step(self->cpu)) {
+            LOG("CPU stopped");
+            self->context->running = false;
+            break;
+        }
+    }
+    return self->ppu->context->current_frame - start;
+}
+
 static void *cpu_run(void *ptr)
 {
     GameboyClass *self = (GameboyClass *) ptr;
@@ -61,6 +106,11 @@ static void *cpu_run(void *ptr)
         if (self->context->die) {
             pthread_exit(NULL);
         }
+        if (atomic_load_explicit(
+                &self->state->context->request, memory_order_relaxed)
+            != STATE_IDLE) {
+            self->state->service(self->state);
+        }
 #ifndef __EMSCRIPTEN__
         if (self->context->paused) {
             self->ui->delay(10);
@@ -71,6 +121,14 @@ static void *cpu_run(void *ptr)
             LOG("CPU stopped");
             break;
         }
+        self->rewind->frame(self->rewind);
+        self->pacer->frame(self->pacer);
+
+        if (self->context->frame_limit
+            && self->ppu->context->current_frame
+                >= self->context->frame_limit) {
+            self->context->die = true;
+        }
     }
     return 0;
 }
@@ -85,12 +143,10 @@ static void loop(void *ptr)
     self->ui->handle_events(self->ui);
     self->sound->update(self->sound);
 
-    if (self->context->prev_frame != self->ppu->context->current_frame) {
+    if (self->ppu->present(self->ppu)) {
         self->ui->update(self->ui);
     }
 
-    self->context->prev_frame = self->ppu->context->current_frame;
-
 #ifdef __EMSCRIPTEN__
     if (self->context->die) {
         emscripten_cancel_main_loop();
@@ -102,34 +158,48 @@ static int32_t run(GameboyClass *self, int argc, char **argv)
 {
     pthread_t thread;
 
-    if (argc < 2) {
-        fprintf(stderr, "Usage: ./gameboy /path/to/rom.gb\n");
-        return 1;
+    const char *rom = NULL;
+    const char *frames = NULL;
+
+    for (int32_t i = 1; i < argc; i++) {
+        if (!strncmp(argv[i], "--speed=", 8)) {
+            if (!self->pacer->parse(self->pacer, argv[i] + 8)) {
+                fprintf(stderr, "Invalid speed: %s\n", argv[i] + 8);
+                return 1;
+            }
+        } else if (!strcmp(argv[i], "--skip-idle")) {
+            self->context->skip_idle = true;
+        } else if (!rom) {
+            rom = argv[i];
+        } else if (!frames) {
+            frames = argv[i];
+        }
     }
 
-    if (!self->cartridge->load(self->cartridge, argv[1])) {
-        fprintf(stderr, "Failed to load ROM file: %s\n", argv[1]);
+    if (!rom) {
+        fprintf(stderr,
+            "Usage: ./gameboy [--speed=N|max|audio] [--skip-idle] "
+            "/path/to/rom.gb [frames]\n");
         return 1;
     }
 
-    if (self->cartridge->context->header->cgb_flag & 0x80) {
-        self->context->hw_mode = HW_CGB;
-        self->cpu->context->registers.a = 0x11;
-        LOG("Running in CGB mode");
-    } else {
-        self->context->hw_mode = HW_DMG;
-        self->cpu->context->registers.a = 0x01;
-        LOG("Running in DMG mode");
+    if (frames) {
+        self->context->frame_limit = strtoul(frames, NULL, 10);
     }
 
+    if (!self->cartridge->load(self->cartridge, rom)) {
+        fprintf(stderr, "Failed to load ROM file: %s\n", rom);
+        return 1;
+    }
+
+    self->boot(self);
+
     LOG("Cartridge successfully loaded");
 
     if (pthread_create(&thread, NULL, self->cpu_run, self) != 0) {
         HANDLE_ERROR("Failed to create thread");
     }
 
-    self->context->prev_frame = 0;
-
 #ifdef __EMSCRIPTEN__
     emscripten_set_main_loop_arg(self->loop, self, 0, 1);
 #else
@@ -146,14 +216,13 @@ static int32_t run(GameboyClass *self, int argc, char **argv)
 static void cycles(GameboyClass *self, int32_t count)
 {
     int32_t t_cycles = self->context->double_speed ? 2 : 4;
-    for (int32_t i = 0; i < count; i++) {
-        for (int32_t n = 0; n < t_cycles; n++) {
-            self->context->ticks += 1;
-            self->timer->tick(self->timer);
-            self->ppu->tick(self->ppu);
-        }
-        self->dma->tick(self->dma);
+    uint64_t target = self->context->ticks + (count * t_cycles);
+
+    if (self->scheduler->context->heap[0].deadline > target) {
+        self->context->ticks = target;
+        return;
     }
+    self->scheduler->run(self->scheduler, target);
 }
 
 const GameboyClass init_gameboy = {
@@ -164,6 +233,8 @@ const GameboyClass init_gameboy = {
         ._destructor = destructor,
     },
     .run = run,
+    .boot = boot,
+    .run_frames = run_frames,
     .cycles = cycles,
     .cpu_run = cpu_run,
     .loop = loop,
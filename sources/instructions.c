@@ -10,74 +10,196 @@ static char *lookup(InstructionsClass *self, instruction_type_t instruction)
     return self->lookup_table[instruction];
 }
 
-static void proc_none(CPUClass UNUSED *cpu)
+static uint8_t fetch8(CPUClass *cpu)
+{
+    uint8_t value = cpu->parent->bus->read(
+        cpu->parent->bus, cpu->context->registers.pc);
+
+    cpu->parent->cycles(cpu->parent, 1);
+    cpu->context->registers.pc++;
+
+    return value;
+}
+
+static uint16_t fetch16(CPUClass *cpu)
+{
+    uint16_t lo = cpu->parent->bus->read(
+        cpu->parent->bus, cpu->context->registers.pc);
+    cpu->parent->cycles(cpu->parent, 1);
+    uint16_t hi = cpu->parent->bus->read(
+        cpu->parent->bus, cpu->context->registers.pc + 1);
+    cpu->parent->cycles(cpu->parent, 1);
+    cpu->context->registers.pc += 2;
+
+    return lo | (hi << 8);
+}
+
+static uint8_t read_memory(CPUClass *cpu, uint16_t address)
+{
+    uint8_t value = cpu->parent->bus->read(cpu->parent->bus, address);
+
+    cpu->parent->cycles(cpu->parent, 1);
+
+    return value;
+}
+
+static void write_memory(CPUClass *cpu, uint16_t address, uint8_t value)
+{
+    cpu->parent->bus->write(cpu->parent->bus, address, value);
+    cpu->parent->cycles(cpu->parent, 1);
+}
+
+static bool check_condition(CPUClass *cpu, const operation_t *op)
+{
+    return !op->mask || (cpu->flags(cpu) & op->mask) == op->flags;
+}
+
+static void defer_flags(
+    CPUClass *cpu, lazy_op_t op, uint8_t x, uint8_t y, uint8_t carry)
+{
+    cpu->context->lazy = (lazy_flags_t) {op, x, y, carry};
+}
+
+static void proc_none(CPUClass UNUSED *cpu, const operation_t UNUSED *op)
 {
     HANDLE_ERROR("invalid instruction");
 }
 
-static void proc_nop(CPUClass UNUSED *cpu)
+static void proc_nop(CPUClass UNUSED *cpu, const operation_t UNUSED *op)
 {
     return;
 }
 
-static void proc_di(CPUClass *cpu)
+static void proc_di(CPUClass *cpu, const operation_t UNUSED *op)
 {
     cpu->context->int_master_enabled = false;
 }
 
-static void proc_ei(CPUClass *cpu)
+static void proc_ei(CPUClass *cpu, const operation_t UNUSED *op)
 {
     cpu->context->enabling_ime = true;
 }
 
-static void proc_ld(CPUClass *cpu)
+static void proc_ld_r_r(CPUClass UNUSED *cpu, const operation_t *op)
 {
-    if (cpu->context->dest_is_mem) {
-        if (cpu->is_16bit(cpu->context->inst->register_2)) {
-            cpu->parent->cycles(cpu->parent, 1);
-            cpu->parent->bus->write16(cpu->parent->bus, cpu->context->mem_dest,
-                cpu->context->fetched_data);
-        } else {
-            cpu->parent->bus->write(cpu->parent->bus, cpu->context->mem_dest,
-                cpu->context->fetched_data);
-        }
-        cpu->parent->cycles(cpu->parent, 1);
-        return;
-    }
-    if (cpu->context->inst->mode == AM_HL_SPR) {
-        uint8_t hflag =
-            (cpu->read_register(cpu, cpu->context->inst->register_2) & 0xF)
-                + (cpu->context->fetched_data & 0xF)
-            >= 0x10;
-        uint8_t cflag =
-            (cpu->read_register(cpu, cpu->context->inst->register_2) & 0xFF)
-                + (cpu->context->fetched_data & 0xFF)
-            >= 0x100;
-        uint16_t address =
-            cpu->read_register(cpu, cpu->context->inst->register_2)
-            + (char) cpu->context->fetched_data;
-        cpu->set_register(cpu, cpu->context->inst->register_1, address);
-        cpu->set_flags(cpu, 0, 0, hflag, cflag);
-        return;
-    }
-    cpu->set_register(
-        cpu, cpu->context->inst->register_1, cpu->context->fetched_data);
+    *op->target = *op->source;
 }
 
-static void proc_ldh(CPUClass *cpu)
+static void proc_ld_r_d8(CPUClass *cpu, const operation_t *op)
 {
-    if (cpu->context->inst->register_1 == RT_A) {
-        cpu->set_register(cpu, cpu->context->inst->register_1,
-            cpu->parent->bus->read(
-                cpu->parent->bus, 0xFF00 | cpu->context->fetched_data));
-    } else {
-        cpu->parent->bus->write(cpu->parent->bus, cpu->context->mem_dest,
-            cpu->context->registers.a);
-    }
+    *op->target = fetch8(cpu);
+}
+
+static void proc_ld_rr_d16(CPUClass *cpu, const operation_t *op)
+{
+    *op->target_pair = fetch16(cpu);
+}
+
+static void proc_ld_sp_hl(CPUClass *cpu, const operation_t UNUSED *op)
+{
+    cpu->context->registers.sp = cpu->context->registers.hl;
+}
+
+static void proc_ld_mrr_r(CPUClass *cpu, const operation_t *op)
+{
+    write_memory(cpu, *op->target_pair, *op->source);
+}
+
+static void proc_ld_mc_r(CPUClass *cpu, const operation_t *op)
+{
+    write_memory(cpu, 0xFF00 | cpu->context->registers.c, *op->source);
+}
+
+static void proc_ld_r_mrr(CPUClass *cpu, const operation_t *op)
+{
+    *op->target = read_memory(cpu, *op->source_pair);
+}
+
+static void proc_ld_r_mc(CPUClass *cpu, const operation_t *op)
+{
+    *op->target = read_memory(cpu, 0xFF00 | cpu->context->registers.c);
+}
+
+static void proc_ld_r_hli(CPUClass *cpu, const operation_t *op)
+{
+    uint16_t address = cpu->context->registers.hl;
+
+    *op->target = read_memory(cpu, address);
+    cpu->context->registers.hl = address + 1;
+}
+
+static void proc_ld_r_hld(CPUClass *cpu, const operation_t *op)
+{
+    uint16_t address = cpu->context->registers.hl;
+
+    *op->target = read_memory(cpu, address);
+    cpu->context->registers.hl = address - 1;
+}
+
+static void proc_ld_hli_r(CPUClass *cpu, const operation_t *op)
+{
+    uint16_t address = cpu->context->registers.hl;
+
+    cpu->context->registers.hl = address + 1;
+    write_memory(cpu, address, *op->source);
+}
+
+static void proc_ld_hld_r(CPUClass *cpu, const operation_t *op)
+{
+    uint16_t address = cpu->context->registers.hl;
+
+    cpu->context->registers.hl = address - 1;
+    write_memory(cpu, address, *op->source);
+}
+
+static void proc_ld_mhl_d8(CPUClass *cpu, const operation_t UNUSED *op)
+{
+    uint8_t value = fetch8(cpu);
+
+    write_memory(cpu, cpu->context->registers.hl, value);
+}
+
+static void proc_ld_a16_r(CPUClass *cpu, const operation_t *op)
+{
+    write_memory(cpu, fetch16(cpu), *op->source);
+}
+
+static void proc_ld_a16_sp(CPUClass *cpu, const operation_t UNUSED *op)
+{
+    uint16_t address = fetch16(cpu);
+
     cpu->parent->cycles(cpu->parent, 1);
+    cpu->parent->bus->write16(
+        cpu->parent->bus, address, cpu->context->registers.sp);
+    cpu->parent->cycles(cpu->parent, 1);
+}
+
+static void proc_ld_r_a16(CPUClass *cpu, const operation_t *op)
+{
+    *op->target = read_memory(cpu, fetch16(cpu));
+}
+
+static void proc_ld_hl_spr(CPUClass *cpu, const operation_t UNUSED *op)
+{
+    uint16_t sp = cpu->context->registers.sp;
+    uint8_t offset = fetch8(cpu);
+
+    cpu->context->registers.hl = sp + (int8_t) offset;
+    cpu->set_flags(cpu, 0, 0, (sp & 0xF) + (offset & 0xF) >= 0x10,
+        (sp & 0xFF) + offset >= 0x100);
+}
+
+static void proc_ldh_a8_r(CPUClass *cpu, const operation_t *op)
+{
+    write_memory(cpu, 0xFF00 | fetch8(cpu), *op->source);
+}
+
+static void proc_ldh_r_a8(CPUClass *cpu, const operation_t *op)
+{
+    *op->target = read_memory(cpu, 0xFF00 | fetch8(cpu));
 }
 
-static void proc_rlca(CPUClass *cpu)
+static void proc_rlca(CPUClass *cpu, const operation_t UNUSED *op)
 {
     uint8_t u = cpu->context->registers.a;
     bool c = (u >> 7) & 1;
@@ -87,7 +209,7 @@ static void proc_rlca(CPUClass *cpu)
     cpu->set_flags(cpu, 0, 0, 0, c);
 }
 
-static void proc_rrca(CPUClass *cpu)
+static void proc_rrca(CPUClass *cpu, const operation_t UNUSED *op)
 {
     uint8_t b = cpu->context->registers.a & 1;
 
@@ -96,7 +218,7 @@ static void proc_rrca(CPUClass *cpu)
     cpu->set_flags(cpu, 0, 0, 0, b);
 }
 
-static void proc_rla(CPUClass *cpu)
+static void proc_rla(CPUClass *cpu, const operation_t UNUSED *op)
 {
     uint8_t u = cpu->context->registers.a;
     uint8_t cf = CPU_FLAG_C;
@@ -106,18 +228,32 @@ static void proc_rla(CPUClass *cpu)
     cpu->set_flags(cpu, 0, 0, 0, c);
 }
 
-static void proc_stop(CPUClass *cpu)
+static void proc_rra(CPUClass *cpu, const operation_t UNUSED *op)
+{
+    uint8_t carry = CPU_FLAG_C;
+    uint8_t new_c = cpu->context->registers.a & 1;
+
+    cpu->context->registers.a >>= 1;
+    cpu->context->registers.a |= (carry << 7);
+    cpu->set_flags(cpu, 0, 0, 0, new_c);
+}
+
+static void proc_stop(CPUClass *cpu, const operation_t UNUSED *op)
 {
     if (cpu->parent->context->hw_mode == HW_CGB
         && cpu->parent->context->speed_switch_armed) {
+        cpu->parent->dma->sync(cpu->parent->dma, cpu->parent->context->ticks);
         cpu->parent->context->speed_switch_armed = false;
         cpu->parent->context->double_speed =
             !cpu->parent->context->double_speed;
         cpu->parent->context->stop_cycles_remaining = 2050;
+        if (cpu->parent->dma->transferring(cpu->parent->dma)) {
+            cpu->parent->dma->retime(cpu->parent->dma);
+        }
     }
 }
 
-static void proc_daa(CPUClass *cpu)
+static void proc_daa(CPUClass *cpu, const operation_t UNUSED *op)
 {
     uint8_t u = 0;
     int32_t fc = 0;
@@ -133,406 +269,652 @@ static void proc_daa(CPUClass *cpu)
     cpu->set_flags(cpu, cpu->context->registers.a == 0, -1, 0, fc);
 }
 
-static void proc_cpl(CPUClass *cpu)
+static void proc_cpl(CPUClass *cpu, const operation_t UNUSED *op)
 {
     cpu->context->registers.a = ~cpu->context->registers.a;
     cpu->set_flags(cpu, -1, 1, 1, -1);
 }
 
-static void proc_scf(CPUClass *cpu)
+static void proc_scf(CPUClass *cpu, const operation_t UNUSED *op)
 {
     cpu->set_flags(cpu, -1, 0, 0, 1);
 }
 
-static void proc_ccf(CPUClass *cpu)
+static void proc_ccf(CPUClass *cpu, const operation_t UNUSED *op)
 {
     cpu->set_flags(cpu, -1, 0, 0, CPU_FLAG_C ^ 1);
 }
 
-static void proc_halt(CPUClass *cpu)
+static void proc_halt(CPUClass *cpu, const operation_t UNUSED *op)
 {
     cpu->context->halted = true;
 }
 
-static void proc_rra(CPUClass *cpu)
+static void add(CPUClass *cpu, uint8_t value)
+{
+    defer_flags(cpu, LAZY_ADD, cpu->context->registers.a, value, 0);
+    cpu->context->registers.a += value;
+}
+
+static void adc(CPUClass *cpu, uint8_t value)
 {
     uint8_t carry = CPU_FLAG_C;
-    uint8_t new_c = cpu->context->registers.a & 1;
 
-    cpu->context->registers.a >>= 1;
-    cpu->context->registers.a |= (carry << 7);
-    cpu->set_flags(cpu, 0, 0, 0, new_c);
+    defer_flags(cpu, LAZY_ADD, cpu->context->registers.a, value, carry);
+    cpu->context->registers.a += value + carry;
+}
+
+static void sub(CPUClass *cpu, uint8_t value)
+{
+    defer_flags(cpu, LAZY_SUB, cpu->context->registers.a, value, 0);
+    cpu->context->registers.a -= value;
 }
 
-static void proc_and(CPUClass *cpu)
+static void sbc(CPUClass *cpu, uint8_t value)
 {
-    cpu->context->registers.a &= cpu->context->fetched_data;
-    cpu->set_flags(cpu, cpu->context->registers.a == 0, 0, 1, 0);
+    uint8_t carry = CPU_FLAG_C;
+
+    defer_flags(cpu, LAZY_SUB, cpu->context->registers.a, value, carry);
+    cpu->context->registers.a -= value + carry;
 }
 
-static void proc_or(CPUClass *cpu)
+static void and(CPUClass *cpu, uint8_t value)
 {
-    cpu->context->registers.a |= cpu->context->fetched_data & 0xFF;
-    cpu->set_flags(cpu, cpu->context->registers.a == 0, 0, 0, 0);
+    cpu->context->registers.a &= value;
+    defer_flags(cpu, LAZY_AND, cpu->context->registers.a, 0, 0);
 }
 
-static void proc_cp(CPUClass *cpu)
+static void xor(CPUClass *cpu, uint8_t value)
 {
-    int32_t n = (int32_t) cpu->context->registers.a
-        - (int32_t) cpu->context->fetched_data;
+    cpu->context->registers.a ^= value;
+    defer_flags(cpu, LAZY_OR, cpu->context->registers.a, 0, 0);
+}
 
-    cpu->set_flags(cpu, n == 0, 1,
-        ((int32_t) cpu->context->registers.a & 0x0F)
-                - ((int32_t) cpu->context->fetched_data & 0x0F)
-            < 0,
-        n < 0);
+static void or(CPUClass *cpu, uint8_t value)
+{
+    cpu->context->registers.a |= value;
+    defer_flags(cpu, LAZY_OR, cpu->context->registers.a, 0, 0);
 }
 
-static void proc_cb(CPUClass *cpu)
+static void cp(CPUClass *cpu, uint8_t value)
 {
-    uint8_t op = cpu->context->fetched_data;
-    register_type_t reg = cpu->decode_register(cpu, op & 0b111);
-    uint8_t bit = (op >> 3) & 0b111;
-    uint8_t bit_op = (op >> 6) & 0b11;
-    uint8_t reg_val = cpu->read_register8(cpu, reg);
+    defer_flags(cpu, LAZY_SUB, cpu->context->registers.a, value, 0);
+}
 
-    cpu->parent->cycles(cpu->parent, 1);
-    if (reg == RT_HL) {
-        cpu->parent->cycles(cpu->parent, 2);
-    }
-    switch (bit_op) {
-        case CB_BIT: {
-            return cpu->set_flags(cpu, !(reg_val & (1 << bit)), 0, 1, -1);
-        }
-        case CB_RST: {
-            reg_val &= ~(1 << bit);
-            return cpu->set_register8(cpu, reg, reg_val);
-        }
-        case CB_SET: {
-            reg_val |= (1 << bit);
-            return cpu->set_register8(cpu, reg, reg_val);
-        }
+/* ALU op with a register, (HL) or immediate operand */
+#define ALU_HANDLERS(name)                                                    \
+    static void proc_##name##_r(CPUClass *cpu, const operation_t *op)         \
+    {                                                                         \
+        name(cpu, *op->source);                                               \
+    }                                                                         \
+    static void proc_##name##_mhl(                                            \
+        CPUClass *cpu, const operation_t UNUSED *op)                          \
+    {                                                                         \
+        name(cpu, read_memory(cpu, cpu->context->registers.hl));              \
+    }                                                                         \
+    static void proc_##name##_d8(                                             \
+        CPUClass *cpu, const operation_t UNUSED *op)                          \
+    {                                                                         \
+        name(cpu, fetch8(cpu));                                               \
     }
 
-    bool flag_c = CPU_FLAG_C;
+ALU_HANDLERS(add)
+ALU_HANDLERS(adc)
+ALU_HANDLERS(sub)
+ALU_HANDLERS(sbc)
+ALU_HANDLERS(and)
+ALU_HANDLERS(xor)
+ALU_HANDLERS(or)
+ALU_HANDLERS(cp)
 
-    switch (bit) {
-        case CB_RLC: {
-            bool set_c = false;
-            uint8_t result = (reg_val << 1) & 0xFF;
+static void add_hl(CPUClass *cpu, uint16_t value)
+{
+    uint32_t hl = cpu->context->registers.hl;
 
-            if ((reg_val & (1 << 7)) != 0) {
-                result |= 1;
-                set_c = true;
-            }
-            cpu->set_register8(cpu, reg, result);
-            cpu->set_flags(cpu, result == 0, false, false, set_c);
-            break;
-        }
-        case CB_RRC: {
-            uint8_t old = reg_val;
+    cpu->parent->cycles(cpu->parent, 1);
+    cpu->context->registers.hl = hl + value;
+    cpu->set_flags(cpu, -1, 0, (hl & 0xFFF) + (value & 0xFFF) >= 0x1000,
+        hl + value >= 0x10000);
+}
 
-            reg_val >>= 1;
-            reg_val |= (old << 7);
-            cpu->set_register8(cpu, reg, reg_val);
-            cpu->set_flags(cpu, !reg_val, false, false, old & 1);
-            break;
-        }
-        case CB_RL: {
-            uint8_t old = reg_val;
+static void proc_add_hl_rr(CPUClass *cpu, const operation_t *op)
+{
+    add_hl(cpu, *op->source_pair);
+}
 
-            reg_val <<= 1;
-            reg_val |= flag_c;
-            cpu->set_register8(cpu, reg, reg_val);
-            cpu->set_flags(cpu, !reg_val, false, false, !!(old & 0x80));
-            break;
-        }
-        case CB_RR: {
-            uint8_t old = reg_val;
+static void proc_add_sp_e8(CPUClass *cpu, const operation_t UNUSED *op)
+{
+    uint16_t sp = cpu->context->registers.sp;
+    uint8_t offset = fetch8(cpu);
 
-            reg_val >>= 1;
-            reg_val |= (flag_c << 7);
-            cpu->set_register8(cpu, reg, reg_val);
-            cpu->set_flags(cpu, !reg_val, false, false, old & 1);
-            break;
-        }
-        case CB_SLA: {
-            uint8_t old = reg_val;
+    cpu->parent->cycles(cpu->parent, 1);
+    cpu->context->registers.sp = sp + (int8_t) offset;
+    cpu->set_flags(cpu, 0, 0, (sp & 0xF) + (offset & 0xF) >= 0x10,
+        (sp & 0xFF) + offset >= 0x100);
+}
 
-            reg_val <<= 1;
-            cpu->set_register8(cpu, reg, reg_val);
-            cpu->set_flags(cpu, !reg_val, false, false, !!(old & 0x80));
-            break;
-        }
-        case CB_SRA: {
-            uint8_t u = (int8_t) reg_val >> 1;
+static void proc_inc_r(CPUClass *cpu, const operation_t *op)
+{
+    uint8_t value = *op->target + 1;
 
-            cpu->set_register8(cpu, reg, u);
-            cpu->set_flags(cpu, !u, 0, 0, reg_val & 1);
-            break;
-        }
-        case CB_SWP: {
-            reg_val = ((reg_val & 0xF0) >> 4) | ((reg_val & 0xF) << 4);
-            cpu->set_register8(cpu, reg, reg_val);
-            cpu->set_flags(cpu, reg_val == 0, false, false, false);
-            break;
-        }
-        case CB_SRL: {
-            uint8_t u = reg_val >> 1;
-            cpu->set_register8(cpu, reg, u);
-            cpu->set_flags(cpu, !u, 0, 0, reg_val & 1);
-            break;
-        }
-    }
+    *op->target = value;
+    defer_flags(cpu, LAZY_INC, value, 0, CPU_FLAG_C);
+}
+
+static void proc_dec_r(CPUClass *cpu, const operation_t *op)
+{
+    uint8_t value = *op->target - 1;
+
+    *op->target = value;
+    defer_flags(cpu, LAZY_DEC, value, 0, CPU_FLAG_C);
+}
+
+static void proc_inc_mhl(CPUClass *cpu, const operation_t UNUSED *op)
+{
+    uint16_t address = cpu->context->registers.hl;
+
+    cpu->parent->cycles(cpu->parent, 2);
+    uint8_t value = cpu->parent->bus->read(cpu->parent->bus, address) + 1;
+    cpu->parent->bus->write(cpu->parent->bus, address, value);
+    defer_flags(cpu, LAZY_INC, value, 0, CPU_FLAG_C);
+}
+
+static void proc_dec_mhl(CPUClass *cpu, const operation_t UNUSED *op)
+{
+    uint16_t address = cpu->context->registers.hl;
+
+    cpu->parent->cycles(cpu->parent, 2);
+    uint8_t value = cpu->parent->bus->read(cpu->parent->bus, address) - 1;
+    cpu->parent->bus->write(cpu->parent->bus, address, value);
+    defer_flags(cpu, LAZY_DEC, value, 0, CPU_FLAG_C);
 }
 
-static void proc_xor(CPUClass *cpu)
+static void proc_inc_rr(CPUClass *cpu, const operation_t *op)
 {
-    cpu->context->registers.a ^= cpu->context->fetched_data & 0xFF;
-    cpu->set_flags(cpu, cpu->context->registers.a == 0, 0, 0, 0);
+    cpu->parent->cycles(cpu->parent, 1);
+    (*op->target_pair)++;
+}
+
+static void proc_dec_rr(CPUClass *cpu, const operation_t *op)
+{
+    cpu->parent->cycles(cpu->parent, 1);
+    (*op->target_pair)--;
 }
 
-static void jump(CPUClass *cpu, uint16_t address, bool push_pc)
+static void jump(
+    CPUClass *cpu, const operation_t *op, uint16_t address, bool push_pc)
 {
-    if (cpu->check_condition(cpu)) {
+    if (check_condition(cpu, op)) {
         if (push_pc) {
             cpu->parent->cycles(cpu->parent, 2);
             cpu->parent->stack->push16(
-                cpu->parent->stack, cpu->get_registers(cpu)->pc);
+                cpu->parent->stack, cpu->context->registers.pc);
         }
-        cpu->get_registers(cpu)->pc = address;
+        cpu->context->registers.pc = address;
         cpu->parent->cycles(cpu->parent, 1);
     }
 }
 
-static void proc_jp(CPUClass *cpu)
+static void proc_jp(CPUClass *cpu, const operation_t *op)
+{
+    jump(cpu, op, fetch16(cpu), false);
+}
+
+static void proc_jp_hl(CPUClass *cpu, const operation_t *op)
 {
-    jump(cpu, cpu->context->fetched_data, false);
+    jump(cpu, op, cpu->context->registers.hl, false);
 }
 
-static void proc_jr(CPUClass *cpu)
+static void proc_jr(CPUClass *cpu, const operation_t *op)
 {
-    char offset = (char) (cpu->context->fetched_data & 0xFF);
-    uint16_t address = cpu->context->registers.pc + offset;
-    jump(cpu, address, false);
+    int8_t offset = (int8_t) fetch8(cpu);
+    uint16_t pc = cpu->context->registers.pc;
+
+    jump(cpu, op, pc + offset, false);
+    if (cpu->parent->context->skip_idle && offset < 0
+        && cpu->context->registers.pc != pc) {
+        cpu->skip_idle(cpu, op, offset);
+    }
 }
 
-static void proc_call(CPUClass *cpu)
+static void proc_call(CPUClass *cpu, const operation_t *op)
 {
-    jump(cpu, cpu->context->fetched_data, true);
+    jump(cpu, op, fetch16(cpu), true);
 }
 
-static void proc_rst(CPUClass *cpu)
+static void proc_rst(CPUClass *cpu, const operation_t *op)
 {
-    jump(cpu, cpu->context->inst->parameter, true);
+    jump(cpu, op, op->vector, true);
 }
 
-static void proc_ret(CPUClass *cpu)
+static void proc_ret(CPUClass *cpu, const operation_t *op)
 {
-    if (cpu->context->inst->condition != CT_NONE) {
+    if (op->mask) {
         cpu->parent->cycles(cpu->parent, 1);
     }
-    if (cpu->check_condition(cpu)) {
+    if (check_condition(cpu, op)) {
         uint16_t lo = cpu->parent->stack->pop(cpu->parent->stack);
         cpu->parent->cycles(cpu->parent, 1);
         uint16_t hi = cpu->parent->stack->pop(cpu->parent->stack);
         cpu->parent->cycles(cpu->parent, 1);
 
-        uint16_t n = (hi << 8) | lo;
-        cpu->context->registers.pc = n;
+        cpu->context->registers.pc = (hi << 8) | lo;
         cpu->parent->cycles(cpu->parent, 1);
     }
 }
 
-static void proc_reti(CPUClass *cpu)
+static void proc_reti(CPUClass *cpu, const operation_t *op)
 {
     cpu->context->int_master_enabled = true;
-    proc_ret(cpu);
+    proc_ret(cpu, op);
 }
 
-static void proc_pop(CPUClass *cpu)
+static void proc_pop(CPUClass *cpu, const operation_t *op)
 {
     uint16_t lo = cpu->parent->stack->pop(cpu->parent->stack);
     cpu->parent->cycles(cpu->parent, 1);
     uint16_t hi = cpu->parent->stack->pop(cpu->parent->stack);
     cpu->parent->cycles(cpu->parent, 1);
 
-    uint16_t n = (hi << 8) | lo;
-    cpu->set_register(cpu, cpu->context->inst->register_1, n);
+    *op->target_pair = (hi << 8) | lo;
+}
 
-    if (cpu->context->inst->register_1 == RT_AF) {
-        cpu->set_register(cpu, cpu->context->inst->register_1, n & 0xFFF0);
-    }
+static void proc_pop_af(CPUClass *cpu, const operation_t *op)
+{
+    proc_pop(cpu, op);
+    cpu->context->registers.f &= 0xF0;
+    cpu->context->lazy.op = LAZY_NONE;
 }
 
-static void proc_push(CPUClass *cpu)
+static void proc_push(CPUClass *cpu, const operation_t *op)
 {
-    uint8_t hi =
-        (cpu->read_register(cpu, cpu->context->inst->register_1) >> 8) & 0xFF;
     cpu->parent->cycles(cpu->parent, 1);
-    cpu->parent->stack->push(cpu->parent->stack, hi);
-
-    uint8_t lo =
-        cpu->read_register(cpu, cpu->context->inst->register_1) & 0xFF;
+    cpu->parent->stack->push(cpu->parent->stack, *op->target_pair >> 8);
     cpu->parent->cycles(cpu->parent, 1);
-    cpu->parent->stack->push(cpu->parent->stack, lo);
-
+    cpu->parent->stack->push(cpu->parent->stack, *op->target_pair & 0xFF);
     cpu->parent->cycles(cpu->parent, 1);
 }
 
-static void proc_inc(CPUClass *cpu)
+static void proc_push_af(CPUClass *cpu, const operation_t *op)
+{
+    cpu->flags(cpu);
+    proc_push(cpu, op);
+}
+
+static void proc_cb(CPUClass *cpu, const operation_t UNUSED *op)
 {
-    uint16_t value =
-        cpu->read_register(cpu, cpu->context->inst->register_1) + 1;
+    const operation_t *cb = &cpu->cb_operations[fetch8(cpu)];
 
-    if (cpu->is_16bit(cpu->context->inst->register_1)) {
-        cpu->parent->cycles(cpu->parent, 1);
-    }
-    if (cpu->context->inst->register_1 == RT_HL
-        && cpu->context->inst->mode == AM_MR) {
-        value = cpu->parent->bus->read(
-                    cpu->parent->bus, cpu->read_register(cpu, RT_HL))
-            + 1;
-        value &= 0xFF;
-        cpu->parent->bus->write(
-            cpu->parent->bus, cpu->read_register(cpu, RT_HL), value);
-    } else {
-        cpu->set_register(cpu, cpu->context->inst->register_1, value);
-        value = cpu->read_register(cpu, cpu->context->inst->register_1);
-    }
-    if ((cpu->context->opcode & 0x03) == 0x03) {
-        return;
+    cb->handler(cpu, cb);
+}
+
+static uint8_t rlc(CPUClass *cpu, const operation_t UNUSED *op, uint8_t value)
+{
+    uint8_t result = (value << 1) | (value >> 7);
+
+    cpu->set_flags(cpu, result == 0, false, false, value >> 7);
+    return result;
+}
+
+static uint8_t rrc(CPUClass *cpu, const operation_t UNUSED *op, uint8_t value)
+{
+    uint8_t result = (value >> 1) | (value << 7);
+
+    cpu->set_flags(cpu, result == 0, false, false, value & 1);
+    return result;
+}
+
+static uint8_t rl(CPUClass *cpu, const operation_t UNUSED *op, uint8_t value)
+{
+    uint8_t result = (value << 1) | CPU_FLAG_C;
+
+    cpu->set_flags(cpu, result == 0, false, false, value >> 7);
+    return result;
+}
+
+static uint8_t rr(CPUClass *cpu, const operation_t UNUSED *op, uint8_t value)
+{
+    uint8_t result = (value >> 1) | (CPU_FLAG_C << 7);
+
+    cpu->set_flags(cpu, result == 0, false, false, value & 1);
+    return result;
+}
+
+static uint8_t sla(CPUClass *cpu, const operation_t UNUSED *op, uint8_t value)
+{
+    uint8_t result = value << 1;
+
+    cpu->set_flags(cpu, result == 0, false, false, value >> 7);
+    return result;
+}
+
+static uint8_t sra(CPUClass *cpu, const operation_t UNUSED *op, uint8_t value)
+{
+    uint8_t result = (int8_t) value >> 1;
+
+    cpu->set_flags(cpu, result == 0, false, false, value & 1);
+    return result;
+}
+
+static uint8_t swap(
+    CPUClass *cpu, const operation_t UNUSED *op, uint8_t value)
+{
+    uint8_t result = (value >> 4) | (value << 4);
+
+    cpu->set_flags(cpu, result == 0, false, false, false);
+    return result;
+}
+
+static uint8_t srl(CPUClass *cpu, const operation_t UNUSED *op, uint8_t value)
+{
+    uint8_t result = value >> 1;
+
+    cpu->set_flags(cpu, result == 0, false, false, value & 1);
+    return result;
+}
+
+static uint8_t res(
+    CPUClass UNUSED *cpu, const operation_t *op, uint8_t value)
+{
+    return value & ~op->mask;
+}
+
+static uint8_t set(
+    CPUClass UNUSED *cpu, const operation_t *op, uint8_t value)
+{
+    return value | op->mask;
+}
+
+/* CB read-modify-write on a register or (HL) */
+#define CB_HANDLERS(name)                                                     \
+    static void proc_##name##_r(CPUClass *cpu, const operation_t *op)         \
+    {                                                                         \
+        cpu->parent->cycles(cpu->parent, 1);                                  \
+        *op->target = name(cpu, op, *op->target);                             \
+    }                                                                         \
+    static void proc_##name##_mhl(CPUClass *cpu, const operation_t *op)       \
+    {                                                                         \
+        uint16_t address = cpu->context->registers.hl;                        \
+        uint8_t value =                                                       \
+            cpu->parent->bus->read(cpu->parent->bus, address);                \
+                                                                              \
+        cpu->parent->cycles(cpu->parent, 1);                                  \
+        cpu->parent->cycles(cpu->parent, 2);                                  \
+        cpu->parent->bus->write(                                              \
+            cpu->parent->bus, address, name(cpu, op, value));                 \
     }
-    cpu->set_flags(cpu, value == 0, 0, (value & 0x0F) == 0, -1);
+
+CB_HANDLERS(rlc)
+CB_HANDLERS(rrc)
+CB_HANDLERS(rl)
+CB_HANDLERS(rr)
+CB_HANDLERS(sla)
+CB_HANDLERS(sra)
+CB_HANDLERS(swap)
+CB_HANDLERS(srl)
+CB_HANDLERS(res)
+CB_HANDLERS(set)
+
+static void proc_bit_r(CPUClass *cpu, const operation_t *op)
+{
+    cpu->parent->cycles(cpu->parent, 1);
+    cpu->set_flags(cpu, !(*op->target & op->mask), 0, 1, -1);
 }
 
-static void proc_dec(CPUClass *cpu)
+static void proc_bit_mhl(CPUClass *cpu, const operation_t *op)
 {
-    uint16_t value =
-        cpu->read_register(cpu, cpu->context->inst->register_1) - 1;
+    uint8_t value =
+        cpu->parent->bus->read(cpu->parent->bus, cpu->context->registers.hl);
 
-    if (cpu->is_16bit(cpu->context->inst->register_1)) {
-        cpu->parent->cycles(cpu->parent, 1);
+    cpu->parent->cycles(cpu->parent, 1);
+    cpu->parent->cycles(cpu->parent, 2);
+    cpu->set_flags(cpu, !(value & op->mask), 0, 1, -1);
+}
+
+static uint8_t *register8(CPUClass *cpu, register_type_t type)
+{
+    registers_t *registers = &cpu->context->registers;
+
+    switch (type) {
+        case RT_A: return &registers->a;
+        case RT_F: return &registers->f;
+        case RT_B: return &registers->b;
+        case RT_C: return &registers->c;
+        case RT_D: return &registers->d;
+        case RT_E: return &registers->e;
+        case RT_H: return &registers->h;
+        case RT_L: return &registers->l;
+        default: return NULL;
     }
-    if (cpu->context->inst->register_1 == RT_HL
-        && cpu->context->inst->mode == AM_MR) {
-        value = cpu->parent->bus->read(
-                    cpu->parent->bus, cpu->read_register(cpu, RT_HL))
-            - 1;
-        cpu->parent->bus->write(
-            cpu->parent->bus, cpu->read_register(cpu, RT_HL), value);
-    } else {
-        cpu->set_register(cpu, cpu->context->inst->register_1, value);
-        value = cpu->read_register(cpu, cpu->context->inst->register_1);
+}
+
+static uint16_t *register16(CPUClass *cpu, register_type_t type)
+{
+    registers_t *registers = &cpu->context->registers;
+
+    switch (type) {
+        case RT_AF: return &registers->af;
+        case RT_BC: return &registers->bc;
+        case RT_DE: return &registers->de;
+        case RT_HL: return &registers->hl;
+        case RT_SP: return &registers->sp;
+        case RT_PC: return &registers->pc;
+        default: return NULL;
     }
-    if ((cpu->context->opcode & 0x0B) == 0x0B) {
-        return;
+}
+
+static proc_fn by_operand(
+    address_mode_t mode, proc_fn from_r, proc_fn from_mhl, proc_fn from_d8)
+{
+    switch (mode) {
+        case AM_R_R: return from_r;
+        case AM_R_MR: return from_mhl;
+        case AM_R_D8: return from_d8;
+        default: return proc_none;
     }
-    cpu->set_flags(cpu, value == 0, 1, (value & 0x0F) == 0x0F, -1);
 }
 
-static void proc_add(CPUClass *cpu)
+static proc_fn decode_ld(instruction_t *inst)
 {
-    uint32_t value = cpu->read_register(cpu, cpu->context->inst->register_1)
-        + cpu->context->fetched_data;
-    bool is_16bit = cpu->is_16bit(cpu->context->inst->register_1);
+    switch (inst->mode) {
+        case AM_R_R:
+            return inst->register_1 == RT_SP ? proc_ld_sp_hl : proc_ld_r_r;
+        case AM_R_D8: return proc_ld_r_d8;
+        case AM_R_D16: return proc_ld_rr_d16;
+        case AM_MR_R:
+            return inst->register_1 == RT_C ? proc_ld_mc_r : proc_ld_mrr_r;
+        case AM_R_MR:
+            return inst->register_2 == RT_C ? proc_ld_r_mc : proc_ld_r_mrr;
+        case AM_R_HLI: return proc_ld_r_hli;
+        case AM_R_HLD: return proc_ld_r_hld;
+        case AM_HLI_R: return proc_ld_hli_r;
+        case AM_HLD_R: return proc_ld_hld_r;
+        case AM_MR_D8: return proc_ld_mhl_d8;
+        case AM_A16_R:
+            return inst->register_2 == RT_SP ? proc_ld_a16_sp : proc_ld_a16_r;
+        case AM_R_A16: return proc_ld_r_a16;
+        case AM_HL_SPR: return proc_ld_hl_spr;
+        default: return proc_none;
+    }
+}
 
-    if (is_16bit) {
-        cpu->parent->cycles(cpu->parent, 1);
+static proc_fn decode_add(instruction_t *inst)
+{
+    if (inst->register_1 == RT_SP) {
+        return proc_add_sp_e8;
     }
-    if (cpu->context->inst->register_1 == RT_SP) {
-        value = cpu->read_register(cpu, cpu->context->inst->register_1)
-            + (char) cpu->context->fetched_data;
+    if (inst->register_1 == RT_HL) {
+        return proc_add_hl_rr;
     }
+    return by_operand(inst->mode, proc_add_r, proc_add_mhl, proc_add_d8);
+}
 
-    int32_t z = (value & 0XFF) == 0;
-    int32_t h = (cpu->read_register(cpu, cpu->context->inst->register_1) & 0xF)
-            + (cpu->context->fetched_data & 0xF)
-        >= 0x10;
-    int32_t c =
-        (int32_t) (cpu->read_register(cpu, cpu->context->inst->register_1)
-            & 0xFF)
-            + (int32_t) (cpu->context->fetched_data & 0xFF)
-        >= 0x100;
-
-    if (is_16bit) {
-        z = -1;
-        h = (cpu->read_register(cpu, cpu->context->inst->register_1) & 0xFFF)
-                + (cpu->context->fetched_data & 0xFFF)
-            >= 0x1000;
-        uint32_t n = ((uint32_t) cpu->read_register(
-                         cpu, cpu->context->inst->register_1))
-            + ((uint32_t) cpu->context->fetched_data);
-        c = n >= 0x10000;
+static proc_fn decode_step(instruction_t *inst, bool increment)
+{
+    if (inst->mode == AM_MR) {
+        return increment ? proc_inc_mhl : proc_dec_mhl;
     }
-    if (cpu->context->inst->register_1 == RT_SP) {
-        z = 0;
-        h = (cpu->read_register(cpu, cpu->context->inst->register_1) & 0xF)
-                + (cpu->context->fetched_data & 0xF)
-            >= 0x10;
-        c = (int32_t) (cpu->read_register(cpu, cpu->context->inst->register_1)
-                & 0xFF)
-                + (int32_t) (cpu->context->fetched_data & 0xFF)
-            >= 0x100;
+    if (inst->register_1 >= RT_AF) {
+        return increment ? proc_inc_rr : proc_dec_rr;
     }
-    cpu->set_register(cpu, cpu->context->inst->register_1, value & 0xFFFF);
-    cpu->set_flags(cpu, z, 0, h, c);
+    return increment ? proc_inc_r : proc_dec_r;
 }
 
-static void proc_adc(CPUClass *cpu)
+static proc_fn decode_handler(instruction_t *inst)
 {
-    uint16_t u = cpu->context->fetched_data;
-    uint16_t a = cpu->context->registers.a;
-    uint16_t c = CPU_FLAG_C;
-
-    cpu->context->registers.a = (a + u + c) & 0xFF;
-    cpu->set_flags(cpu, cpu->context->registers.a == 0, 0,
-        (a & 0xF) + (u & 0xF) + c > 0xF, a + u + c > 0xFF);
+    switch (inst->type) {
+        case IN_NOP: return proc_nop;
+        case IN_LD: return decode_ld(inst);
+        case IN_LDH:
+            return inst->register_1 == RT_A ? proc_ldh_r_a8 : proc_ldh_a8_r;
+        case IN_INC: return decode_step(inst, true);
+        case IN_DEC: return decode_step(inst, false);
+        case IN_ADD: return decode_add(inst);
+        case IN_ADC:
+            return by_operand(
+                inst->mode, proc_adc_r, proc_adc_mhl, proc_adc_d8);
+        case IN_SUB:
+            return by_operand(
+                inst->mode, proc_sub_r, proc_sub_mhl, proc_sub_d8);
+        case IN_SBC:
+            return by_operand(
+                inst->mode, proc_sbc_r, proc_sbc_mhl, proc_sbc_d8);
+        case IN_AND:
+            return by_operand(
+                inst->mode, proc_and_r, proc_and_mhl, proc_and_d8);
+        case IN_XOR:
+            return by_operand(
+                inst->mode, proc_xor_r, proc_xor_mhl, proc_xor_d8);
+        case IN_OR:
+            return by_operand(inst->mode, proc_or_r, proc_or_mhl, proc_or_d8);
+        case IN_CP:
+            return by_operand(inst->mode, proc_cp_r, proc_cp_mhl, proc_cp_d8);
+        case IN_JP: return inst->mode == AM_R ? proc_jp_hl : proc_jp;
+        case IN_JR: return proc_jr;
+        case IN_CALL: return proc_call;
+        case IN_RST: return proc_rst;
+        case IN_RET: return proc_ret;
+        case IN_RETI: return proc_reti;
+        case IN_POP:
+            return inst->register_1 == RT_AF ? proc_pop_af : proc_pop;
+        case IN_PUSH:
+            return inst->register_1 == RT_AF ? proc_push_af : proc_push;
+        case IN_CB: return proc_cb;
+        case IN_RLCA: return proc_rlca;
+        case IN_RRCA: return proc_rrca;
+        case IN_RLA: return proc_rla;
+        case IN_RRA: return proc_rra;
+        case IN_STOP: return proc_stop;
+        case IN_DAA: return proc_daa;
+        case IN_CPL: return proc_cpl;
+        case IN_SCF: return proc_scf;
+        case IN_CCF: return proc_ccf;
+        case IN_HALT: return proc_halt;
+        case IN_DI: return proc_di;
+        case IN_EI: return proc_ei;
+        default: return proc_none;
+    }
 }
 
-static void proc_sub(CPUClass *cpu)
+/*
+ * Resolves an opcode once into its handler with the operands it touches
+ * bound as register pointers, so step() dispatches without re-decoding.
+ * A condition holds when F & mask equals flags.
+ */
+static operation_t decode(
+    InstructionsClass *self, CPUClass *cpu, uint8_t opcode)
 {
-    uint16_t value = cpu->read_register(cpu, cpu->context->inst->register_1)
-        - cpu->context->fetched_data;
-    int32_t z = value == 0;
-    int32_t h =
-        ((int32_t) cpu->read_register(cpu, cpu->context->inst->register_1)
-            & 0xF)
-            - ((int32_t) cpu->context->fetched_data & 0xF)
-        < 0;
-    int32_t c =
-        ((int32_t) cpu->read_register(cpu, cpu->context->inst->register_1))
-            - ((int32_t) cpu->context->fetched_data)
-        < 0;
+    instruction_t *inst = self->by_opcode(self, opcode);
+    operation_t operation = {
+        .handler = decode_handler(inst),
+        .target = register8(cpu, inst->register_1),
+        .source = register8(cpu, inst->register_2),
+        .target_pair = register16(cpu, inst->register_1),
+        .source_pair = register16(cpu, inst->register_2),
+        .vector = inst->parameter,
+    };
+
+    switch (inst->condition) {
+        case CT_NONE: break;
+        case CT_NZ: operation.mask = 0x80; break;
+        case CT_Z: operation.mask = operation.flags = 0x80; break;
+        case CT_NC: operation.mask = 0x10; break;
+        case CT_C: operation.mask = operation.flags = 0x10; break;
+    }
 
-    cpu->set_register(cpu, cpu->context->inst->register_1, value);
-    cpu->set_flags(cpu, z, 1, h, c);
+    return operation;
 }
 
-static void proc_sbc(CPUClass *cpu)
+static uint8_t length(InstructionsClass *self, uint8_t opcode)
 {
-    uint8_t value = cpu->context->fetched_data + CPU_FLAG_C;
-    int32_t z =
-        (cpu->read_register(cpu, cpu->context->inst->register_1) - value) == 0;
-    int32_t h =
-        ((int32_t) cpu->read_register(cpu, cpu->context->inst->register_1)
-            & 0xF)
-            - ((int32_t) cpu->context->fetched_data & 0xF)
-            - ((int32_t) CPU_FLAG_C)
-        < 0;
-    int32_t c =
-        ((int32_t) cpu->read_register(cpu, cpu->context->inst->register_1))
-            - ((int32_t) cpu->context->fetched_data) - ((int32_t) CPU_FLAG_C)
-        < 0;
+    switch (self->by_opcode(self, opcode)->mode) {
+        case AM_R_D8:
+        case AM_R_A8:
+        case AM_A8_R:
+        case AM_HL_SPR:
+        case AM_D8:
+        case AM_MR_D8: return 2;
+        case AM_R_D16:
+        case AM_R_A16:
+        case AM_A16_R:
+        case AM_D16_R:
+        case AM_D16: return 3;
+        default: return 1;
+    }
+}
 
-    cpu->set_register(cpu, cpu->context->inst->register_1,
-        cpu->read_register(cpu, cpu->context->inst->register_1) - value);
-    cpu->set_flags(cpu, z, 1, h, c);
+/* True for anything that may leave the straight-line path after it */
+static bool branches(InstructionsClass *self, uint8_t opcode)
+{
+    switch (self->by_opcode(self, opcode)->type) {
+        case IN_NONE:
+        case IN_JP:
+        case IN_JR:
+        case IN_CALL:
+        case IN_RET:
+        case IN_RETI:
+        case IN_RST:
+        case IN_HALT:
+        case IN_STOP: return true;
+        default: return false;
+    }
 }
 
-static proc_fn get_proc(InstructionsClass *self, instruction_type_t type)
+static operation_t decode_cb(
+    InstructionsClass UNUSED *self, CPUClass *cpu, uint8_t opcode)
 {
-    return self->processors[type];
+    static const proc_fn by_register[][2] = {
+        [CB_RLC] = {proc_rlc_r, proc_rlc_mhl},
+        [CB_RRC] = {proc_rrc_r, proc_rrc_mhl},
+        [CB_RL] = {proc_rl_r, proc_rl_mhl},
+        [CB_RR] = {proc_rr_r, proc_rr_mhl},
+        [CB_SLA] = {proc_sla_r, proc_sla_mhl},
+        [CB_SRA] = {proc_sra_r, proc_sra_mhl},
+        [CB_SWP] = {proc_swap_r, proc_swap_mhl},
+        [CB_SRL] = {proc_srl_r, proc_srl_mhl},
+    };
+    register_type_t reg = cpu->decode_register(cpu, opcode & 0b111);
+    uint8_t bit = (opcode >> 3) & 0b111;
+    bool memory = reg == RT_HL;
+    operation_t operation = {
+        .target = register8(cpu, reg),
+        .mask = 1 << bit,
+    };
+
+    switch ((opcode >> 6) & 0b11) {
+        case CB_BIT:
+            operation.handler = memory ? proc_bit_mhl : proc_bit_r;
+            break;
+        case CB_RST:
+            operation.handler = memory ? proc_res_mhl : proc_res_r;
+            break;
+        case CB_SET:
+            operation.handler = memory ? proc_set_mhl : proc_set_r;
+            break;
+        default: operation.handler = by_register[bit][memory]; break;
+    }
+
+    return operation;
 }
 
 const InstructionsClass init_instructions =
@@ -842,47 +1224,12 @@ const InstructionsClass init_instructions =
                 "IN_RES",
                 "IN_SET",
             },
-        .processors =
-            {
-                [IN_NONE] = proc_none,
-                [IN_NOP] = proc_nop,
-                [IN_LD] = proc_ld,
-                [IN_LDH] = proc_ldh,
-                [IN_JP] = proc_jp,
-                [IN_DI] = proc_di,
-                [IN_POP] = proc_pop,
-                [IN_PUSH] = proc_push,
-                [IN_JR] = proc_jr,
-                [IN_CALL] = proc_call,
-                [IN_RET] = proc_ret,
-                [IN_RST] = proc_rst,
-                [IN_INC] = proc_inc,
-                [IN_DEC] = proc_dec,
-                [IN_ADD] = proc_add,
-                [IN_ADC] = proc_adc,
-                [IN_SUB] = proc_sub,
-                [IN_SBC] = proc_sbc,
-                [IN_RETI] = proc_reti,
-                [IN_XOR] = proc_xor,
-                [IN_AND] = proc_and,
-                [IN_OR] = proc_or,
-                [IN_CP] = proc_cp,
-                [IN_RRCA] = proc_rrca,
-                [IN_RLCA] = proc_rlca,
-                [IN_RRA] = proc_rra,
-                [IN_RLA] = proc_rla,
-                [IN_STOP] = proc_stop,
-                [IN_CB] = proc_cb,
-                [IN_HALT] = proc_halt,
-                [IN_DAA] = proc_daa,
-                [IN_CPL] = proc_cpl,
-                [IN_SCF] = proc_scf,
-                [IN_CCF] = proc_ccf,
-                [IN_EI] = proc_ei,
-            },
         .by_opcode = by_opcode,
         .lookup = lookup,
-        .get_proc = get_proc,
+        .decode = decode,
+        .decode_cb = decode_cb,
+        .length = length,
+        .branches = branches,
 };
 
 const class_t *Instructions = (const class_t *) &init_instructions;
@@ -6,6 +6,28 @@ static void constructor(void *ptr, va_list *args)
     self->parent = va_arg(*args, GameboyClass *);
 }
 
+static void serial_start(IOClass *self)
+{
+    uint32_t bit_ticks = 512;
+
+    if (self->parent->context->hw_mode == HW_CGB
+        && (self->serial_data[1] & 0x02)) {
+        bit_ticks = 16;
+    }
+    if (self->parent->context->double_speed) {
+        bit_ticks /= 2;
+    }
+    self->parent->scheduler->schedule(self->parent->scheduler, EV_SERIAL,
+        self->parent->context->ticks + (bit_ticks * 8));
+}
+
+static void serial_tick(IOClass *self)
+{
+    self->serial_data[0] = 0xFF;
+    self->serial_data[1] &= 0x7F;
+    self->parent->cpu->request_interrupt(self->parent->cpu, IT_SERIAL);
+}
+
 static uint8_t read(IOClass *self, uint16_t address)
 {
     switch (address) {
@@ -96,6 +118,12 @@ static void write(IOClass *self, uint16_t address, uint8_t value)
         }
         case SERIAL_CONTROL: {
             self->serial_data[1] = value;
+            if ((value & 0x81) == 0x81) {
+                self->serial_start(self);
+            } else {
+                self->parent->scheduler->cancel(
+                    self->parent->scheduler, EV_SERIAL);
+            }
             break;
         }
         case TIMER_RANGE: {
@@ -134,6 +162,7 @@ static void write(IOClass *self, uint16_t address, uint8_t value)
                 if (self->parent->ram->context->wram_bank == 0) {
                     self->parent->ram->context->wram_bank = 1;
                 }
+                self->parent->bus->remap(self->parent->bus);
             }
             break;
         }
@@ -180,6 +209,8 @@ const IOClass init_io = {
     },
     .read = read,
     .write = write,
+    .serial_start = serial_start,
+    .serial_tick = serial_tick,
 };
 
 const class_t *IO = (const class_t *) &init_io;
@@ -47,12 +47,55 @@ static void hdma_start(LCDClass *self, uint8_t value)
 
     if (!self->context->hdma.hblank_mode) {
         while (self->context->hdma.remaining > 0) {
-            self->hdma_tick(self);
+            self->hdma_block(self);
         }
         self->context->hdma.active = false;
     }
 }
 
+/*
+ * Moves the next 0x10 bytes and stalls the CPU for the 32 dots it takes.
+ * Blocks are 16 byte aligned at both ends, so a source in a mapped page
+ * and a destination inside VRAM are copied in one go; anything else goes
+ * through the bus a byte at a time.
+ */
+static void hdma_block(LCDClass *self)
+{
+    hdma_context_t *hdma = &self->context->hdma;
+    PPUClass *ppu = self->parent->ppu;
+    DMAClass *dma = self->parent->dma;
+    const uint8_t *page =
+        self->parent->bus->context->read_pages[hdma->source >> 8];
+
+    if (!hdma->active || hdma->remaining == 0) {
+        return;
+    }
+
+    if (page && hdma->dest < 0xA000) {
+        dma->sync(dma, self->parent->context->ticks);
+        ppu->fallback(ppu);
+        uint16_t offset =
+            (ppu->context->vram_bank * 0x2000) + (hdma->dest - 0x8000);
+
+        memmove(ppu->context->vram + offset, page + (hdma->source & 0xFF),
+            0x10);
+        ppu->touch_tile(ppu, offset, 0x10);
+        hdma->source += 0x10;
+        hdma->dest += 0x10;
+        hdma->remaining -= 0x10;
+        hdma->active = hdma->remaining > 0;
+    } else {
+        for (int32_t i = 0; i < 0x10; i++) {
+            self->hdma_tick(self);
+        }
+    }
+
+    if (!self->parent->cpu->context->halted) {
+        self->parent->context->stop_cycles_remaining +=
+            self->parent->context->double_speed ? 16 : 8;
+    }
+}
+
 static void hdma_tick(LCDClass *self)
 {
     if (!self->context->hdma.active || self->context->hdma.remaining == 0) {
@@ -71,6 +114,11 @@ static void hdma_tick(LCDClass *self)
     }
 }
 
+static void hdma_hblank(LCDClass *self)
+{
+    self->hdma_block(self);
+}
+
 static void constructor(void *ptr, va_list *args)
 {
     LCDClass *self = (LCDClass *) ptr;
@@ -145,10 +193,13 @@ static uint8_t read(LCDClass *self, uint16_t address)
 
 static void write(LCDClass *self, uint16_t address, uint8_t value)
 {
+    self->parent->ppu->fallback(self->parent->ppu);
+
     switch (address) {
         case LCD_VBK:
             if (self->parent->context->hw_mode == HW_CGB) {
                 self->parent->ppu->context->vram_bank = value & 0x01;
+                self->parent->bus->remap(self->parent->bus);
             }
             return;
         case LCD_HDMA1: self->context->hdma.hdma1 = value; return;
@@ -190,9 +241,15 @@ static void write(LCDClass *self, uint16_t address, uint8_t value)
                 return;
             }
 
+            if (address == LCD_STATUS) {
+                self->parent->ppu->sync(self->parent->ppu);
+            }
+
             ((uint8_t *) self->context)[offset] = value;
 
-            if (address == TRANSFER_REG) {
+            if (address == LCD_STATUS) {
+                self->parent->ppu->schedule(self->parent->ppu);
+            } else if (address == TRANSFER_REG) {
                 self->parent->dma->start(self->parent->dma, value);
             } else if (address == LCD_BG_PAL) {
                 self->update(self, value, 0);
@@ -231,6 +288,8 @@ const LCDClass init_lcd = {
     .update = update,
     .hdma_start = hdma_start,
     .hdma_tick = hdma_tick,
+    .hdma_block = hdma_block,
+    .hdma_hblank = hdma_hblank,
 };
 
 const class_t *LCD = (const class_t *) &init_lcd;
@@ -0,0 +1,90 @@
+#include "../include/libgameboy.h"
+#include "../include/gameboy.h"
+
+gb_t *gb_create_from_memory(const uint8_t *rom, size_t size)
+{
+    if (!rom) {
+        return NULL;
+    }
+
+    GameboyClass *gameboy = new_class(Gameboy);
+    if (!gameboy) {
+        return NULL;
+    }
+
+    if (!gameboy->cartridge->load_memory(gameboy->cartridge, rom, size)) {
+        destroy_class(gameboy);
+        return NULL;
+    }
+
+    gameboy->boot(gameboy);
+
+    return gameboy;
+}
+
+uint32_t gb_run_frames(gb_t *gb, uint32_t count)
+{
+    return gb->run_frames(gb, count);
+}
+
+void gb_set_input(gb_t *gb, uint8_t buttons)
+{
+    joypad_state_t *state = &gb->joypad->context->state;
+
+    state->a = buttons & GB_BUTTON_A;
+    state->b = buttons & GB_BUTTON_B;
+    state->select = buttons & GB_BUTTON_SELECT;
+    state->start = buttons & GB_BUTTON_START;
+    state->right = buttons & GB_BUTTON_RIGHT;
+    state->left = buttons & GB_BUTTON_LEFT;
+    state->up = buttons & GB_BUTTON_UP;
+    state->down = buttons & GB_BUTTON_DOWN;
+}
+
+void gb_set_skip_idle(gb_t *gb, int enabled)
+{
+    gb->context->skip_idle = enabled;
+}
+
+const uint32_t *gb_get_framebuffer(gb_t *gb)
+{
+    gb->ppu->present(gb->ppu);
+
+    return gb->ppu->context->frames[gb->ppu->context->front_frame];
+}
+
+size_t gb_get_audio(gb_t *gb, int16_t *buffer, size_t frames)
+{
+    gb->sound->sync(gb->sound);
+
+    return gb->sound->pop(gb->sound, buffer, frames);
+}
+
+uint32_t gb_get_audio_overruns(gb_t *gb)
+{
+    return atomic_load_explicit(
+        &gb->sound->context->ring.overruns, memory_order_relaxed);
+}
+
+size_t gb_state_size(gb_t *gb)
+{
+    return gb->state->size(gb->state);
+}
+
+size_t gb_save_state(gb_t *gb, uint8_t *buffer, size_t capacity)
+{
+    return gb->state->save(gb->state, buffer, capacity);
+}
+
+int gb_load_state(gb_t *gb, const uint8_t *buffer, size_t size)
+{
+    return gb->state->load(gb->state, buffer, size);
+}
+
+void gb_destroy(gb_t *gb)
+{
+    if (!gb) {
+        return;
+    }
+    destroy_class(gb);
+}
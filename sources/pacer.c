@@ -0,0 +1,249 @@
+#define _POSIX_C_SOURCE 200112L
+#include <time.h>
+#include "../include/gameboy.h"
+
+static void constructor(void *ptr, va_list *args)
+{
+    PacerClass *self = (PacerClass *) ptr;
+    if (!((self->context = calloc(1, sizeof(*self->context))))) {
+        HANDLE_ERROR("failed memory allocation");
+    }
+    self->parent = va_arg(*args, GameboyClass *);
+#ifdef HEADLESS
+    self->set(self, PACE_UNLIMITED, 1.0);
+#else
+    self->set(self, PACE_AUDIO, 1.0);
+#endif
+}
+
+static void destructor(void *ptr)
+{
+    PacerClass *self = (PacerClass *) ptr;
+    free(self->context);
+}
+
+static uint64_t now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void set(PacerClass *self, pace_mode_t mode, double speed)
+{
+    if (mode == PACE_SCALED && speed == 1.0) {
+        mode = PACE_REALTIME;
+    }
+    if (mode == PACE_AUDIO && !self->parent->sound->context->initialized) {
+        mode = PACE_REALTIME;
+    }
+    if (mode == PACE_REALTIME || mode == PACE_AUDIO || speed <= 0.0) {
+        speed = 1.0;
+    }
+
+    self->context->mode = mode;
+    self->context->speed = speed;
+    self->context->frame_ns = (uint64_t) (1e9
+        * (LINES_PER_FRAME * TICKS_PER_LINE) / DOTS_PER_SECOND / speed);
+    self->context->deadline = 0;
+    self->context->fill = PACE_AUDIO_FILL;
+
+    /* whatever piled up meanwhile would otherwise delay audio for seconds */
+    if (mode == PACE_AUDIO) {
+        self->parent->sound->trim(self->parent->sound, PACE_AUDIO_FILL);
+        self->context->played = self->parent->sound->played(
+            self->parent->sound);
+        self->context->played_at = now();
+        self->context->stalled = false;
+    }
+}
+
+static bool parse(PacerClass *self, const char *value)
+{
+    if (!strcmp(value, "max") || !strcmp(value, "unlimited")) {
+        self->set(self, PACE_UNLIMITED, 1.0);
+        return true;
+    }
+    if (!strcmp(value, "audio")) {
+        self->set(self, PACE_AUDIO, 1.0);
+        return true;
+    }
+
+    char *end = NULL;
+    double speed = strtod(value, &end);
+    if (end == value || *end || speed < 0.0) {
+        return false;
+    }
+
+    if (speed == 0.0) {
+        self->set(self, PACE_UNLIMITED, 1.0);
+    } else {
+        self->set(self, PACE_SCALED, speed);
+    }
+    return true;
+}
+
+/* Called from the UI thread; frame() applies it on the emulation thread */
+static void toggle(PacerClass *self)
+{
+    atomic_fetch_add_explicit(
+        &self->context->toggles, 1, memory_order_relaxed);
+}
+
+static void fast_forward(PacerClass *self)
+{
+    if (self->context->mode == PACE_UNLIMITED) {
+        pace_mode_t mode = self->context->resume_mode;
+        self->set(self,
+            mode == PACE_UNLIMITED ? PACE_REALTIME : mode,
+            self->context->speed);
+        LOG("Fast-forward off");
+    } else {
+        self->context->resume_mode = self->context->mode;
+        self->context->mode = PACE_UNLIMITED;
+        LOG("Fast-forward on");
+    }
+}
+
+static void wait(PacerClass UNUSED *self, uint64_t deadline)
+{
+    uint64_t current = now();
+
+    /* sleep coarsely, then spin the remainder for sub-millisecond accuracy */
+    if (deadline > current + PACE_SPIN_NS) {
+        uint64_t until = deadline - PACE_SPIN_NS;
+        struct timespec ts = {
+            .tv_sec = until / 1000000000ULL,
+            .tv_nsec = until % 1000000000ULL,
+        };
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+    }
+
+    while (now() < deadline) {
+    }
+}
+
+/*
+ * Audio is the master clock: wait for the device to play the ring down to
+ * PACE_AUDIO_FILL frames, then nudge the APU output rate by up to
+ * PACE_AUDIO_DRC so the fill settles there instead of sawing between
+ * underruns and long waits. The fill is smoothed because the device takes
+ * AUDIO_SAMPLES frames at a time.
+ *
+ * A device that has not taken anything for four frames is stalled (or not
+ * started yet, as in a suspended browser audio context): returns false so
+ * the caller paces by the wall clock, and trims the backlog once it pulls
+ * again.
+ */
+static bool drain(PacerClass *self)
+{
+    SoundClass *sound = self->parent->sound;
+    uint32_t played = sound->played(sound);
+    uint64_t current = now();
+
+    if (played != self->context->played) {
+        if (self->context->stalled) {
+            sound->trim(sound, PACE_AUDIO_FILL);
+            self->context->fill = PACE_AUDIO_FILL;
+            self->context->stalled = false;
+        }
+        self->context->played = played;
+        self->context->played_at = current;
+    } else if (current
+        > self->context->played_at + 4 * self->context->frame_ns) {
+        self->context->stalled = true;
+    }
+
+    if (self->context->stalled) {
+        return false;
+    }
+
+    size_t buffered = sound->buffered(sound);
+
+    if (buffered > PACE_AUDIO_FILL) {
+        uint64_t wait_ns = (uint64_t) (buffered - PACE_AUDIO_FILL)
+            * 1000000000ULL / AUDIO_FREQUENCY;
+
+        /* a pending trim has not been applied yet, or the device stalled */
+        if (wait_ns > 4 * self->context->frame_ns) {
+            wait_ns = 4 * self->context->frame_ns;
+        }
+        self->wait(self, current + wait_ns);
+        buffered = sound->buffered(sound);
+    }
+
+    self->context->fill += (buffered - self->context->fill) / 8;
+
+    double ratio = 1.0
+        + (PACE_AUDIO_DRC * (1.0 - (self->context->fill / PACE_AUDIO_FILL)));
+
+    if (ratio < 1.0 - PACE_AUDIO_DRC) {
+        ratio = 1.0 - PACE_AUDIO_DRC;
+    } else if (ratio > 1.0 + PACE_AUDIO_DRC) {
+        ratio = 1.0 + PACE_AUDIO_DRC;
+    }
+    sound->set_rate(sound, ratio);
+
+    return true;
+}
+
+static void frame(PacerClass *self)
+{
+    uint32_t current_frame = self->parent->ppu->context->current_frame;
+
+    if (current_frame == self->context->last_frame) {
+        return;
+    }
+    self->context->last_frame = current_frame;
+
+    /* an even number of presses since the last frame cancels out */
+    uint32_t toggles = atomic_exchange_explicit(
+        &self->context->toggles, 0, memory_order_relaxed);
+
+    if (toggles & 1) {
+        self->fast_forward(self);
+    }
+
+    if (self->context->mode == PACE_AUDIO && self->drain(self)) {
+        self->context->deadline = 0;
+        return;
+    }
+    self->parent->sound->set_rate(self->parent->sound, 1.0);
+
+    if (self->context->mode == PACE_UNLIMITED) {
+        self->context->deadline = 0;
+        return;
+    }
+
+    uint64_t current = now();
+
+    /* start over instead of racing to catch up after a stall */
+    if (!self->context->deadline
+        || current > self->context->deadline + 4 * self->context->frame_ns) {
+        self->context->deadline = current + self->context->frame_ns;
+        return;
+    }
+
+    self->wait(self, self->context->deadline);
+    self->context->deadline += self->context->frame_ns;
+}
+
+const PacerClass init_pacer = {
+    {
+        ._size = sizeof(PacerClass),
+        ._name = "Pacer",
+        ._constructor = constructor,
+        ._destructor = destructor,
+    },
+    .set = set,
+    .parse = parse,
+    .toggle = toggle,
+    .fast_forward = fast_forward,
+    .frame = frame,
+    .drain = drain,
+    .now = now,
+    .wait = wait,
+};
+
+const class_t *Pacer = (const class_t *) &init_pacer;
@@ -6,37 +6,20 @@ static void constructor(void *ptr, va_list *args)
     self->parent = va_arg(*args, GameboyClass *);
 }
 
-static void destructor(void *ptr)
-{
-    PipelineClass *self = (PipelineClass *) ptr;
-    if (self->parent->ppu->context != NULL) {
-        self->fifo_reset(self);
-    }
-}
-
 static void fifo_push(PipelineClass *self, uint32_t value)
 {
-    fifo_entry_t *next = calloc(1, sizeof(*next));
+    fifo_t *fifo = &self->parent->ppu->context->pixel_context->pixel_fifo;
 
-    if (!next) {
-        HANDLE_ERROR("failed memory allocation");
-    }
-    next->value = value;
-
-    if (!self->parent->ppu->context->pixel_context->pixel_fifo.head)
-        self->parent->ppu->context->pixel_context->pixel_fifo.head =
-            self->parent->ppu->context->pixel_context->pixel_fifo.tail = next;
-    else {
-        self->parent->ppu->context->pixel_context->pixel_fifo.tail->next =
-            next;
-        self->parent->ppu->context->pixel_context->pixel_fifo.tail = next;
-    }
+    if (fifo->size >= FIFO_CAPACITY)
+        HANDLE_ERROR("pixel fifo overflow");
 
-    self->parent->ppu->context->pixel_context->pixel_fifo.size++;
+    fifo->entries[fifo->tail] = value;
+    fifo->tail = (fifo->tail + 1) % FIFO_CAPACITY;
+    fifo->size++;
 }
 
-static uint32_t fetch_sprite_pixels(PipelineClass *self, int32_t bit,
-    uint32_t color, uint8_t bg_color, bool bg_priority)
+static uint32_t fetch_sprite_pixels(PipelineClass *self, uint32_t color,
+    uint8_t bg_color, bool bg_priority)
 {
     for (int32_t i = 0; i < self->parent->ppu->context->fetch_entry_count;
         i++) {
@@ -56,17 +39,11 @@ static uint32_t fetch_sprite_pixels(PipelineClass *self, int32_t bit,
 
         uint8_t attrs =
             self->parent->ppu->context->fetched_entries[i].attributes;
-        bit = ((attrs >> 5) & 1) ? offset : (7 - offset);
+        uint8_t sprite_color =
+            (self->parent->ppu->context->pixel_context->sprite_rows[i]
+                >> (offset * 8))
+            & 0x03;
 
-        uint8_t hi = !!(
-            self->parent->ppu->context->pixel_context->fetch_entry_data[i * 2]
-            & (1 << bit));
-        uint8_t lo = !!(self->parent->ppu->context->pixel_context
-                             ->fetch_entry_data[(i * 2) + 1]
-                         & (1 << bit))
-            << 1;
-
-        uint8_t sprite_color = hi | lo;
         if (!sprite_color) {
             continue;
         }
@@ -94,21 +71,40 @@ static uint32_t fetch_sprite_pixels(PipelineClass *self, int32_t bit,
 
 static uint32_t fifo_pop(PipelineClass *self)
 {
-    uint32_t value = 0;
-    fifo_entry_t *popped = NULL;
+    fifo_t *fifo = &self->parent->ppu->context->pixel_context->pixel_fifo;
 
-    if (self->parent->ppu->context->pixel_context->pixel_fifo.size <= 0)
+    if (fifo->size <= 0)
         HANDLE_ERROR("invalid pixel fifo size");
 
-    popped = self->parent->ppu->context->pixel_context->pixel_fifo.head;
-    value = popped->value;
+    uint32_t value = fifo->entries[fifo->head];
+    fifo->head = (fifo->head + 1) % FIFO_CAPACITY;
+    fifo->size--;
+
+    return value;
+}
 
-    self->parent->ppu->context->pixel_context->pixel_fifo.head = popped->next;
-    self->parent->ppu->context->pixel_context->pixel_fifo.size--;
+static uint32_t pixel_color(PipelineClass *self, int8_t i)
+{
+    uint8_t attrs = self->parent->ppu->context->pixel_context->bg_attributes;
+    uint8_t color_index =
+        (self->parent->ppu->context->pixel_context->bg_row >> (i * 8)) & 0x03;
+    uint32_t color;
+
+    if (self->parent->context->hw_mode == HW_CGB) {
+        color = self->parent->lcd->context
+                    ->bg_colors_cgb[attrs & 0x07][color_index];
+    } else {
+        color = LCDC_BGW_ENABLE
+            ? self->parent->lcd->context->bg_colors[color_index]
+            : self->parent->lcd->context->bg_colors[0];
+    }
 
-    free(popped);
+    if (LCDC_OBJ_ENABLE) {
+        color = self->fetch_sprite_pixels(
+            self, color, color_index, (attrs >> 7) & 1);
+    }
 
-    return value;
+    return color;
 }
 
 static bool fifo_add(PipelineClass *self)
@@ -121,39 +117,8 @@ static bool fifo_add(PipelineClass *self)
     int32_t x = self->parent->ppu->context->pixel_context->fetch_x
         - (MAX_FIFO_ITEMS - (self->parent->lcd->context->scroll_x % 8));
 
-    uint8_t attrs =
-        self->parent->ppu->context->pixel_context->bg_fetch_data[3];
-
     for (int8_t i = 0; i < MAX_FIFO_ITEMS; i++) {
-        int8_t bit =
-            (((attrs >> 5) & 1) && self->parent->context->hw_mode == HW_CGB)
-            ? i
-            : (7 - i);
-
-        uint8_t hi =
-            !!(self->parent->ppu->context->pixel_context->bg_fetch_data[1]
-                & (1 << bit));
-        uint8_t lo =
-            !!(self->parent->ppu->context->pixel_context->bg_fetch_data[2]
-                & (1 << bit))
-            << 1;
-
-        uint8_t color_index = hi | lo;
-        uint32_t color;
-
-        if (self->parent->context->hw_mode == HW_CGB) {
-            color = self->parent->lcd->context
-                        ->bg_colors_cgb[attrs & 0x07][color_index];
-        } else {
-            color = LCDC_BGW_ENABLE
-                ? self->parent->lcd->context->bg_colors[color_index]
-                : self->parent->lcd->context->bg_colors[0];
-        }
-
-        if (LCDC_OBJ_ENABLE) {
-            color = self->fetch_sprite_pixels(
-                self, bit, color, color_index, (attrs >> 7) & 1);
-        }
+        uint32_t color = self->pixel_color(self, i);
 
         if (x >= 0) {
             self->fifo_push(self, color);
@@ -194,7 +159,12 @@ static void load_sprite_tile(PipelineClass *self)
     }
 }
 
-static void load_sprite_data(PipelineClass *self, uint8_t offset)
+/*
+ * Sprite rows come from the tile cache already X-flipped as needed, so
+ * fetch_sprite_pixels reads pixel n of a sprite from byte n of its row.
+ * On DMG the VRAM bank is always 0.
+ */
+static void load_sprite_data(PipelineClass *self)
 {
     int32_t current_y = self->parent->lcd->context->y_coord;
     uint8_t sprite_height = LCDC_OBJ_HEIGHT;
@@ -217,122 +187,88 @@ static void load_sprite_data(PipelineClass *self, uint8_t offset)
             }
         }
 
-        uint16_t vram_addr = (tile_index * 16) + tile_y + offset;
-        uint8_t data;
+        uint16_t vram_addr = (tile_index * 16) + tile_y;
+        uint8_t bank = self->parent->context->hw_mode == HW_CGB
+            ? (entry->attributes >> 3) & 1
+            : 0;
+        uint8_t flip = (entry->attributes >> 5) & 1;
+
+        self->parent->ppu->context->pixel_context->sprite_rows[i] =
+            self->parent->ppu->context
+                ->tile_cache[bank][vram_addr >> 4][flip][(vram_addr >> 1) & 7];
+    }
+}
+
+static void load_tile(PipelineClass *self)
+{
+    self->parent->ppu->context->fetch_entry_count = 0;
+    if (LCDC_BGW_ENABLE) {
+        uint32_t map_x = self->parent->ppu->context->pixel_context->map_x;
+        uint32_t map_y = self->parent->ppu->context->pixel_context->map_y;
+        uint32_t map_offset =
+            LCDC_BG_MAP_AREA + (map_x / 8) + ((map_y / 8) * 32);
+
+        self->parent->ppu->context->pixel_context->bg_tile =
+            self->parent->bus->read(self->parent->bus, map_offset);
 
         if (self->parent->context->hw_mode == HW_CGB) {
-            uint16_t vram_offset =
-                ((entry->attributes >> 3) & 1) * 0x2000 + vram_addr;
-            data = self->parent->ppu->context->vram[vram_offset];
+            uint16_t attr_offset = 0x2000 + (map_offset - 0x8000);
+            self->parent->ppu->context->pixel_context->bg_attributes =
+                self->parent->ppu->context->vram[attr_offset];
         } else {
-            data =
-                self->parent->bus->read(self->parent->bus, 0x8000 + vram_addr);
+            self->parent->ppu->context->pixel_context->bg_attributes = 0;
+        }
+
+        if (LCDC_BGW_DATA_AREA == 0x8800) {
+            self->parent->ppu->context->pixel_context->bg_tile += 128;
         }
 
-        self->parent->ppu->context->pixel_context
-            ->fetch_entry_data[(i * 2) + offset] = data;
+        self->load_window_tile(self);
+    }
+
+    if (LCDC_OBJ_ENABLE && self->parent->ppu->context->line_sprites) {
+        self->load_sprite_tile(self);
     }
 }
 
+/*
+ * Both bitplanes of a row are taken from the tile cache at once, on the
+ * second data fetch, when the hardware has read them both.
+ */
+static void load_tile_data(PipelineClass *self)
+{
+    uint32_t tile = self->parent->ppu->context->pixel_context->bg_tile
+        + ((LCDC_BGW_DATA_AREA - 0x8000) / 16);
+    uint32_t tile_y = self->parent->ppu->context->pixel_context->tile_y / 2;
+    uint8_t attrs = self->parent->ppu->context->pixel_context->bg_attributes;
+
+    if ((attrs >> 6) & 1) {
+        tile_y = 7 - tile_y;
+    }
+
+    /* attributes are always 0 on DMG */
+    self->parent->ppu->context->pixel_context->bg_row =
+        self->parent->ppu->context
+            ->tile_cache[(attrs >> 3) & 1][tile][(attrs >> 5) & 1][tile_y];
+
+    self->load_sprite_data(self);
+}
+
 static void fetch(PipelineClass *self)
 {
     switch (self->parent->ppu->context->pixel_context->state) {
         case FS_TILE: {
-            self->parent->ppu->context->fetch_entry_count = 0;
-            if (LCDC_BGW_ENABLE) {
-                uint32_t map_x =
-                    self->parent->ppu->context->pixel_context->map_x;
-                uint32_t map_y =
-                    self->parent->ppu->context->pixel_context->map_y;
-                uint32_t map_offset =
-                    LCDC_BG_MAP_AREA + (map_x / 8) + ((map_y / 8) * 32);
-
-                self->parent->ppu->context->pixel_context->bg_fetch_data[0] =
-                    self->parent->bus->read(self->parent->bus, map_offset);
-
-                if (self->parent->context->hw_mode == HW_CGB) {
-                    uint8_t saved_vram_bank =
-                        self->parent->ppu->context->vram_bank;
-                    self->parent->ppu->context->vram_bank = 1;
-                    self->parent->ppu->context->pixel_context
-                        ->bg_fetch_data[3] =
-                        self->parent->bus->read(self->parent->bus, map_offset);
-                    self->parent->ppu->context->vram_bank = saved_vram_bank;
-                } else {
-                    self->parent->ppu->context->pixel_context
-                        ->bg_fetch_data[3] = 0;
-                }
-
-                if (LCDC_BGW_DATA_AREA == 0x8800) {
-                    self->parent->ppu->context->pixel_context
-                        ->bg_fetch_data[0] += 128;
-                }
-
-                self->load_window_tile(self);
-            }
-
-            if (LCDC_OBJ_ENABLE && self->parent->ppu->context->line_sprites) {
-                self->load_sprite_tile(self);
-            }
-
+            self->load_tile(self);
             self->parent->ppu->context->pixel_context->state = FS_DATA0;
             self->parent->ppu->context->pixel_context->fetch_x += 8;
             break;
         }
         case FS_DATA0: {
-            uint32_t bgw_fetch_data =
-                self->parent->ppu->context->pixel_context->bg_fetch_data[0];
-            uint32_t tile_y =
-                self->parent->ppu->context->pixel_context->tile_y;
-            uint8_t attrs =
-                self->parent->ppu->context->pixel_context->bg_fetch_data[3];
-
-            if (self->parent->context->hw_mode == HW_CGB) {
-                if ((attrs >> 6) & 1) {
-                    tile_y = 14 - tile_y;
-                }
-                uint16_t vram_addr = (LCDC_BGW_DATA_AREA - 0x8000)
-                    + (bgw_fetch_data * 16) + tile_y;
-                uint16_t vram_offset = ((attrs >> 3) & 1) * 0x2000 + vram_addr;
-                self->parent->ppu->context->pixel_context->bg_fetch_data[1] =
-                    self->parent->ppu->context->vram[vram_offset];
-            } else {
-                self->parent->ppu->context->pixel_context->bg_fetch_data[1] =
-                    self->parent->bus->read(self->parent->bus,
-                        LCDC_BGW_DATA_AREA + (bgw_fetch_data * 16) + tile_y);
-            }
-
-            self->load_sprite_data(self, 0);
-
             self->parent->ppu->context->pixel_context->state = FS_DATA1;
             break;
         }
         case FS_DATA1: {
-            uint32_t bgw_fetch_data =
-                self->parent->ppu->context->pixel_context->bg_fetch_data[0];
-            uint32_t tile_y =
-                self->parent->ppu->context->pixel_context->tile_y;
-            uint8_t attrs =
-                self->parent->ppu->context->pixel_context->bg_fetch_data[3];
-
-            if (self->parent->context->hw_mode == HW_CGB) {
-                if ((attrs >> 6) & 1) {
-                    tile_y = 14 - tile_y;
-                }
-                uint16_t vram_addr = (LCDC_BGW_DATA_AREA - 0x8000)
-                    + (bgw_fetch_data * 16) + tile_y + 1;
-                uint16_t vram_offset = ((attrs >> 3) & 1) * 0x2000 + vram_addr;
-                self->parent->ppu->context->pixel_context->bg_fetch_data[2] =
-                    self->parent->ppu->context->vram[vram_offset];
-            } else {
-                self->parent->ppu->context->pixel_context->bg_fetch_data[2] =
-                    self->parent->bus->read(self->parent->bus,
-                        LCDC_BGW_DATA_AREA + (bgw_fetch_data * 16) + tile_y
-                            + 1);
-            }
-
-            self->load_sprite_data(self, 1);
-
+            self->load_tile_data(self);
             self->parent->ppu->context->pixel_context->state = FS_IDLE;
             break;
         }
@@ -386,12 +322,93 @@ static void process(PipelineClass *self)
     self->push_pixel(self);
 }
 
-static void fifo_reset(PipelineClass *self)
+/*
+ * Colors of the BG/window tile just fetched. With the BG disabled on DMG
+ * every index shows color 0.
+ */
+static void bg_palette(PipelineClass *self, uint32_t *palette)
 {
-    while (self->parent->ppu->context->pixel_context->pixel_fifo.size) {
-        self->fifo_pop(self);
+    const uint32_t *colors = self->parent->lcd->context->bg_colors;
+    bool blank = !LCDC_BGW_ENABLE;
+
+    if (self->parent->context->hw_mode == HW_CGB) {
+        colors = self->parent->lcd->context->bg_colors_cgb
+                     [self->parent->ppu->context->pixel_context->bg_attributes
+                         & 0x07];
+        blank = false;
+    }
+
+    for (int32_t i = 0; i < 4; i++) {
+        palette[i] = colors[blank ? 0 : i];
     }
-    self->parent->ppu->context->pixel_context->pixel_fifo.head = NULL;
+}
+
+/*
+ * Draw the current line in one pass at the end of mode 3. This walks the
+ * same tile fetches as the FIFO, including the ones it makes past the
+ * right edge, so window and fetcher state carried into the next line
+ * match, but writes pixels straight into the video buffer. Each tile row is
+ * colored eight pixels at a time and sprites are only mixed in where the
+ * fetcher found some.
+ */
+static void render_line(PipelineClass *self)
+{
+    fifo_context_t *pixel_context = self->parent->ppu->context->pixel_context;
+    PlanarClass *planar = self->parent->planar;
+    uint8_t y_coord = self->parent->lcd->context->y_coord;
+    uint8_t scroll_x = self->parent->lcd->context->scroll_x;
+    uint8_t fine_x = scroll_x % 8;
+    uint8_t tiles = fine_x < 3 ? 22 : 23;
+    uint32_t *line =
+        self->parent->ppu->context->video_buffer + (y_coord * X_RES);
+
+    pixel_context->map_y = y_coord + self->parent->lcd->context->scroll_y;
+    pixel_context->tile_y =
+        ((y_coord + self->parent->lcd->context->scroll_y) % 8) * 2;
+    pixel_context->fifo_x = 0;
+
+    for (uint8_t tile = 0; tile < tiles; tile++) {
+        pixel_context->fetch_x = tile * 8;
+        pixel_context->map_x = pixel_context->fetch_x + scroll_x;
+        self->load_tile(self);
+        pixel_context->fetch_x += 8;
+
+        if (pixel_context->fifo_x >= X_RES + fine_x) {
+            continue;
+        }
+
+        self->load_tile_data(self);
+
+        uint64_t row = pixel_context->bg_row;
+        bool priority = (pixel_context->bg_attributes >> 7) & 1;
+        bool sprites =
+            LCDC_OBJ_ENABLE && self->parent->ppu->context->fetch_entry_count;
+        uint32_t palette[4];
+        uint32_t colors[MAX_FIFO_ITEMS];
+
+        bg_palette(self, palette);
+        planar->colorize(planar, row, palette, colors);
+
+        for (int8_t i = 0; i < MAX_FIFO_ITEMS; i++) {
+            if (pixel_context->fifo_x >= fine_x
+                && pixel_context->fifo_x < X_RES + fine_x) {
+                line[pixel_context->fifo_x - fine_x] = sprites
+                    ? self->fetch_sprite_pixels(
+                          self, colors[i], (row >> (i * 8)) & 0x03, priority)
+                    : colors[i];
+            }
+            pixel_context->fifo_x++;
+        }
+    }
+}
+
+static void fifo_reset(PipelineClass *self)
+{
+    fifo_t *fifo = &self->parent->ppu->context->pixel_context->pixel_fifo;
+
+    fifo->head = 0;
+    fifo->tail = 0;
+    fifo->size = 0;
 }
 
 static void load_window_tile(PipelineClass *self)
@@ -411,19 +428,17 @@ static void load_window_tile(PipelineClass *self)
                 / 8)
             + (tile_y * 32);
 
-        self->parent->ppu->context->pixel_context->bg_fetch_data[0] =
+        self->parent->ppu->context->pixel_context->bg_tile =
             self->parent->bus->read(self->parent->bus, map_offset);
 
         if (self->parent->context->hw_mode == HW_CGB) {
-            uint8_t saved_vram_bank = self->parent->ppu->context->vram_bank;
-            self->parent->ppu->context->vram_bank = 1;
-            self->parent->ppu->context->pixel_context->bg_fetch_data[3] =
-                self->parent->bus->read(self->parent->bus, map_offset);
-            self->parent->ppu->context->vram_bank = saved_vram_bank;
+            uint16_t attr_offset = 0x2000 + (map_offset - 0x8000);
+            self->parent->ppu->context->pixel_context->bg_attributes =
+                self->parent->ppu->context->vram[attr_offset];
         }
 
         if (LCDC_BGW_DATA_AREA == 0x8800) {
-            self->parent->ppu->context->pixel_context->bg_fetch_data[0] += 128;
+            self->parent->ppu->context->pixel_context->bg_tile += 128;
         }
 
         self->parent->ppu->context->window_rendered_this_line = true;
@@ -441,10 +456,14 @@ const PipelineClass init_pipeline = {
         ._size = sizeof(PipelineClass),
         ._name = "Pipeline",
         ._constructor = constructor,
-        ._destructor = destructor,
+        ._destructor = NULL,
     },
     .fetch = fetch,
     .process = process,
+    .render_line = render_line,
+    .load_tile = load_tile,
+    .load_tile_data = load_tile_data,
+    .pixel_color = pixel_color,
     .fifo_pop = fifo_pop,
     .fifo_push = fifo_push,
     .fifo_add = fifo_add,
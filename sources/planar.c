@@ -0,0 +1,123 @@
+#include "../include/gameboy.h"
+#if defined(__SSE2__)
+    #include <emmintrin.h>
+#elif defined(__ARM_NEON) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    #define PLANAR_NEON
+    #include <arm_neon.h>
+#endif
+
+/*
+ * Decoded rows hold one color index per byte, leftmost pixel in the low
+ * byte. spread[0] moves bit 7 - n of a bitplane byte to bit 0 of byte n,
+ * spread[1] does the same for the X-flipped row.
+ */
+static void constructor(void *ptr, va_list UNUSED *args)
+{
+    PlanarClass *self = (PlanarClass *) ptr;
+    char message[64];
+
+    for (int32_t value = 0; value < 256; value++) {
+        for (int32_t x = 0; x < 8; x++) {
+            uint64_t bit = (value >> (7 - x)) & 1;
+            self->spread[0][value] |= bit << (x * 8);
+            self->spread[1][value] |= bit << ((7 - x) * 8);
+        }
+    }
+    snprintf(message, sizeof(message), "Pixel kernels: %s", self->kernel);
+    LOG(message);
+}
+
+/*
+ * Two table lookups per row already produce all eight pixels; shuffling
+ * the bitplanes in vector registers measured slower, so this is shared by
+ * every target.
+ */
+static void decode(PlanarClass *self, const uint8_t *planes, size_t rows,
+    uint64_t *out, uint64_t *flipped)
+{
+    for (size_t row = 0; row < rows; row++) {
+        uint8_t lo = planes[row * 2];
+        uint8_t hi = planes[(row * 2) + 1];
+
+        out[row] = self->spread[0][lo] | (self->spread[0][hi] << 1);
+        flipped[row] = self->spread[1][lo] | (self->spread[1][hi] << 1);
+    }
+}
+
+static void UNUSED colorize_scalar(PlanarClass UNUSED *self, uint64_t row,
+    const uint32_t *palette, uint32_t *out)
+{
+    for (int32_t x = 0; x < 8; x++) {
+        out[x] = palette[(row >> (x * 8)) & 0x03];
+    }
+}
+
+#if defined(__SSE2__)
+static void colorize_sse2(PlanarClass UNUSED *self, uint64_t row,
+    const uint32_t *palette, uint32_t *out)
+{
+    __m128i zero = _mm_setzero_si128();
+    __m128i indices =
+        _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *) &row), zero);
+    __m128i left = _mm_unpacklo_epi16(indices, zero);
+    __m128i right = _mm_unpackhi_epi16(indices, zero);
+    __m128i left_colors = zero;
+    __m128i right_colors = zero;
+
+    for (int32_t i = 0; i < 4; i++) {
+        __m128i index = _mm_set1_epi32(i);
+        __m128i color = _mm_set1_epi32(palette[i]);
+
+        left_colors = _mm_or_si128(left_colors,
+            _mm_and_si128(_mm_cmpeq_epi32(left, index), color));
+        right_colors = _mm_or_si128(right_colors,
+            _mm_and_si128(_mm_cmpeq_epi32(right, index), color));
+    }
+    _mm_storeu_si128((__m128i *) out, left_colors);
+    _mm_storeu_si128((__m128i *) (out + 4), right_colors);
+}
+#elif defined(PLANAR_NEON)
+static void colorize_neon(PlanarClass UNUSED *self, uint64_t row,
+    const uint32_t *palette, uint32_t *out)
+{
+    uint16x8_t indices = vmovl_u8(vld1_u8((const uint8_t *) &row));
+    uint32x4_t left = vmovl_u16(vget_low_u16(indices));
+    uint32x4_t right = vmovl_u16(vget_high_u16(indices));
+    uint32x4_t left_colors = vdupq_n_u32(0);
+    uint32x4_t right_colors = vdupq_n_u32(0);
+
+    for (uint32_t i = 0; i < 4; i++) {
+        uint32x4_t index = vdupq_n_u32(i);
+        uint32x4_t color = vdupq_n_u32(palette[i]);
+
+        left_colors = vorrq_u32(
+            left_colors, vandq_u32(vceqq_u32(left, index), color));
+        right_colors = vorrq_u32(
+            right_colors, vandq_u32(vceqq_u32(right, index), color));
+    }
+    vst1q_u32(out, left_colors);
+    vst1q_u32(out + 4, right_colors);
+}
+#endif
+
+const PlanarClass init_planar = {
+    {
+        ._size = sizeof(PlanarClass),
+        ._name = "Planar",
+        ._constructor = constructor,
+        ._destructor = NULL,
+    },
+#if defined(__SSE2__)
+    .kernel = "SSE2",
+    .colorize = colorize_sse2,
+#elif defined(PLANAR_NEON)
+    .kernel = "NEON",
+    .colorize = colorize_neon,
+#else
+    .kernel = "scalar",
+    .colorize = colorize_scalar,
+#endif
+    .decode = decode,
+};
+
+const class_t *Planar = (const class_t *) &init_planar;
@@ -6,28 +6,41 @@ static void constructor(void *ptr, va_list *args)
     if (!((self->context = calloc(1, sizeof(*self->context))))) {
         HANDLE_ERROR("failed memory allocation");
     }
-    if (!((self->context->video_buffer = calloc(
-               Y_RES * X_RES, sizeof(*self->context->video_buffer))))) {
+    if (!((self->context->frames[0] = calloc(FRAME_BUFFERS * Y_RES * X_RES,
+               sizeof(*self->context->frames[0]))))) {
         HANDLE_ERROR("failed memory allocation");
     }
     if (!((self->context->pixel_context =
                 calloc(1, sizeof(*self->context->pixel_context))))) {
         HANDLE_ERROR("failed memory allocation");
     }
+    if (!((self->context->tile_cache =
+                calloc(2, sizeof(*self->context->tile_cache))))) {
+        HANDLE_ERROR("failed memory allocation");
+    }
+    for (int32_t i = 1; i < FRAME_BUFFERS; i++) {
+        self->context->frames[i] =
+            self->context->frames[0] + (i * Y_RES * X_RES);
+    }
+    self->context->back_frame = 0;
+    self->context->ready_frame = 1;
+    self->context->front_frame = 2;
+    self->context->video_buffer = self->context->frames[0];
     self->parent = va_arg(*args, GameboyClass *);
-    self->target_time = 1000 / va_arg(*args, size_t);
     self->parent->lcd->context->status &= ~0b11;
     self->parent->lcd->context->status |= MODE_OAM;
     self->context->pixel_context->state = FS_TILE;
     self->context->line_sprites = 0;
     self->context->fetch_entry_count = 0;
+    self->schedule(self);
 }
 
 static void destructor(void *ptr)
 {
     PPUClass *self = (PPUClass *) ptr;
-    free(self->context->video_buffer);
+    free(self->context->frames[0]);
     free(self->context->pixel_context);
+    free(self->context->tile_cache);
     free(self->context);
 }
 
@@ -59,10 +72,45 @@ static uint8_t oam_read(PPUClass *self, uint16_t address)
     return bytes[address];
 }
 
+/*
+ * Re-decodes the tile rows holding a range of VRAM bytes into the tile
+ * cache, both as stored and X-flipped, and flags their tiles in the
+ * per-bank dirty bitmap read by the tile viewer. Tile maps are skipped.
+ */
+static void touch_tile(PPUClass *self, uint16_t offset, uint16_t length)
+{
+    PlanarClass *planar = self->parent->planar;
+    uint16_t end = offset + length;
+
+    for (offset &= ~1; offset < end; offset = (offset | 0x0F) + 1) {
+        uint16_t tile = (offset & 0x1FFF) >> 4;
+
+        if (tile >= TILE_COUNT) {
+            continue;
+        }
+
+        uint8_t bank = offset >> 13;
+        uint8_t row = (offset >> 1) & 7;
+        uint16_t tile_end = (offset | 0x0F) + 1;
+        size_t rows = (((tile_end < end) ? tile_end : end) - offset + 1) / 2;
+
+        planar->decode(planar, self->context->vram + offset, rows,
+            self->context->tile_cache[bank][tile][0] + row,
+            self->context->tile_cache[bank][tile][1] + row);
+
+        tile += bank * TILE_COUNT;
+        atomic_fetch_or_explicit(&self->context->tile_dirty[tile / 32],
+            UINT32_C(1) << (tile % 32), memory_order_release);
+    }
+}
+
 static void vram_write(PPUClass *self, uint16_t address, uint8_t value)
 {
+    self->fallback(self);
+
     uint16_t offset = (self->context->vram_bank * 0x2000) + (address - 0x8000);
     self->context->vram[offset] = value;
+    self->touch_tile(self, offset, 1);
 }
 
 static uint8_t vram_read(PPUClass *self, uint16_t address)
@@ -71,9 +119,67 @@ static uint8_t vram_read(PPUClass *self, uint16_t address)
     return self->context->vram[offset];
 }
 
+/*
+ * Hand the line being drawn by the scanline renderer over to the FIFO
+ * before something that could change its pixels is written. The dots of
+ * mode 3 that already elapsed are replayed through the pipeline first.
+ */
+static void fallback(PPUClass *self)
+{
+    if (!self->context->scanline_pending) {
+        return;
+    }
+
+    self->sync(self);
+    self->context->scanline_pending = false;
+
+    uint32_t line_ticks = self->context->line_ticks;
+
+    for (uint32_t dot = self->context->transfer_start + 1; dot <= line_ticks;
+        dot++) {
+        self->context->line_ticks = dot;
+        self->parent->pipeline->process(self->parent->pipeline);
+    }
+
+    self->parent->bus->remap(self->parent->bus);
+    self->schedule(self);
+}
+
+static void sync(PPUClass *self)
+{
+    uint64_t now = self->parent->context->ticks;
+
+    self->context->line_ticks += now - self->context->last_sync;
+    self->context->last_sync = now;
+}
+
+static void schedule(PPUClass *self)
+{
+    uint32_t target = self->context->line_ticks + 1;
+
+    switch (((lcd_mode_t) (self->parent->lcd->context->status & 0b11))) {
+        case MODE_HBLANK:
+        case MODE_VBLANK: target = TICKS_PER_LINE; break;
+        case MODE_OAM: target = self->context->line_ticks < 1 ? 1 : 80; break;
+        case MODE_TRANSFER: {
+            if (self->context->scanline_pending) {
+                target = self->context->transfer_end;
+            }
+            break;
+        }
+    }
+
+    uint32_t wait = target > self->context->line_ticks
+        ? target - self->context->line_ticks
+        : 1;
+
+    self->parent->scheduler->schedule(
+        self->parent->scheduler, EV_PPU, self->context->last_sync + wait);
+}
+
 static void tick(PPUClass *self)
 {
-    self->context->line_ticks += 1;
+    self->sync(self);
 
     switch (((lcd_mode_t) (self->parent->lcd->context->status & 0b11))) {
         case MODE_HBLANK: self->mode_hblank(self); break;
@@ -81,6 +187,21 @@ static void tick(PPUClass *self)
         case MODE_OAM: self->mode_oam(self); break;
         case MODE_TRANSFER: self->mode_transfer(self); break;
     }
+
+    if ((self->parent->lcd->context->status & 0b11) == MODE_TRANSFER
+        && !self->context->scanline_pending) {
+        uint64_t horizon =
+            self->parent->scheduler->horizon(self->parent->scheduler, EV_PPU);
+
+        while ((self->parent->lcd->context->status & 0b11) == MODE_TRANSFER
+            && self->parent->context->ticks < horizon) {
+            self->parent->context->ticks += 1;
+            self->sync(self);
+            self->mode_transfer(self);
+        }
+    }
+
+    self->schedule(self);
 }
 
 static void increment_y(PPUClass *self)
@@ -122,25 +243,18 @@ static void mode_hblank(PPUClass *self)
         }
 
         self->context->current_frame += 1;
+        self->publish(self);
 
-        uint32_t end = self->parent->ui->get_ticks();
-        uint32_t time = end - self->prev_time;
-
-        if (time < self->target_time) {
-            self->parent->ui->delay(self->target_time - time);
-        }
+        /* by wall clock, so fast-forward does not write more often */
+        if (self->parent->cartridge->context->needs_save) {
+            uint64_t now = self->parent->pacer->now();
 
-        if (end - self->start_timer >= 1000) {
-            self->start_timer = end;
-            self->frame_count = 0;
-            if (self->parent->cartridge->context->needs_save) {
-                self->parent->cartridge->save_battery(self->parent->cartridge);
+            if (now - self->context->last_save >= BATTERY_SAVE_NS) {
+                self->context->last_save = now;
+                self->parent->cartridge->save_battery(
+                    self->parent->cartridge);
             }
         }
-
-        self->frame_count += 1;
-        self->prev_time = self->parent->ui->get_ticks();
-
     } else {
         self->parent->lcd->context->status &= ~0b11;
         self->parent->lcd->context->status |= MODE_OAM;
@@ -148,6 +262,42 @@ static void mode_hblank(PPUClass *self)
     self->context->line_ticks = 0;
 }
 
+/*
+ * The frames form a triple buffer: the PPU draws into the back one, the
+ * presenter shows the front one and the ready one is traded between them
+ * by atomic exchange, tagged with FRAME_NEW while nobody has taken it.
+ * The next back buffer starts as a copy of the frame just published, so
+ * pixels the PPU does not redraw keep their last value as before.
+ */
+static void publish(PPUClass *self)
+{
+    const uint32_t *published = self->context->video_buffer;
+    uint8_t ready = atomic_exchange_explicit(&self->context->ready_frame,
+        self->context->back_frame | FRAME_NEW, memory_order_acq_rel);
+
+    self->context->back_frame = ready & ~FRAME_NEW;
+    self->context->video_buffer =
+        self->context->frames[self->context->back_frame];
+    memcpy(self->context->video_buffer, published,
+        X_RES * Y_RES * sizeof(uint32_t));
+}
+
+/* Takes the latest published frame, if any, as the front buffer */
+static bool present(PPUClass *self)
+{
+    if (!(atomic_load_explicit(
+              &self->context->ready_frame, memory_order_relaxed)
+            & FRAME_NEW)) {
+        return false;
+    }
+
+    uint8_t ready = atomic_exchange_explicit(&self->context->ready_frame,
+        self->context->front_frame, memory_order_acq_rel);
+
+    self->context->front_frame = ready & ~FRAME_NEW;
+    return true;
+}
+
 static void mode_vblank(PPUClass *self)
 {
     if (self->context->line_ticks >= TICKS_PER_LINE) {
@@ -168,6 +318,10 @@ static void load_line_sprites(PPUClass *self)
     int32_t current_y = self->parent->lcd->context->y_coord;
     uint8_t sprite_height = LCDC_OBJ_HEIGHT;
 
+    /* a DMA byte landing on this very tick is dispatched after the PPU */
+    self->parent->dma->sync(
+        self->parent->dma, self->parent->context->ticks - 1);
+
     memset(self->context->line_entry_array, 0,
         sizeof(self->context->line_entry_array));
 
@@ -241,6 +395,18 @@ static void mode_oam(PPUClass *self)
         self->context->pixel_context->fetch_x = 0;
         self->context->pixel_context->pushed_x = 0;
         self->context->pixel_context->fifo_x = 0;
+
+        /* pixels left over from an aborted transfer need the real FIFO */
+        if (self->context->renderer == RENDERER_SCANLINE
+            && !self->context->pixel_context->pixel_fifo.size) {
+            /* mode 3 lasts as long as the FIFO would take for this SCX */
+            uint8_t fine_x = self->parent->lcd->context->scroll_x % 8;
+            self->context->transfer_start = self->context->line_ticks;
+            self->context->transfer_end = self->context->line_ticks + 217
+                + (fine_x ? fine_x + 2 : 0);
+            self->context->scanline_pending = true;
+            self->parent->bus->remap(self->parent->bus);
+        }
     }
 
     if (self->context->line_ticks == 1) {
@@ -259,26 +425,35 @@ static void mode_oam(PPUClass *self)
 
 static void mode_transfer(PPUClass *self)
 {
-    self->parent->pipeline->process(self->parent->pipeline);
+    if (self->context->scanline_pending) {
+        if (self->context->line_ticks < self->context->transfer_end) {
+            return;
+        }
+        self->context->scanline_pending = false;
+        self->parent->pipeline->render_line(self->parent->pipeline);
+        self->parent->bus->remap(self->parent->bus);
+    } else {
+        self->parent->pipeline->process(self->parent->pipeline);
 
-    if (self->context->pixel_context->pushed_x >= X_RES) {
+        if (self->context->pixel_context->pushed_x < X_RES) {
+            return;
+        }
         self->parent->pipeline->fifo_reset(self->parent->pipeline);
-        self->parent->lcd->context->status &= ~0b11;
-        self->parent->lcd->context->status |= MODE_HBLANK;
+    }
 
-        if (self->parent->lcd->context->status & SS_HBLANK) {
-            self->parent->cpu->request_interrupt(
-                self->parent->cpu, IT_LCD_STAT);
-        }
+    self->parent->lcd->context->status &= ~0b11;
+    self->parent->lcd->context->status |= MODE_HBLANK;
 
-        if (self->parent->context->hw_mode == HW_CGB
-            && self->parent->lcd->context->hdma.active
-            && self->parent->lcd->context->hdma.hblank_mode
-            && self->parent->lcd->context->y_coord < Y_RES) {
-            for (int i = 0; i < 0x10; i++) {
-                self->parent->lcd->hdma_tick(self->parent->lcd);
-            }
-        }
+    if (self->parent->lcd->context->status & SS_HBLANK) {
+        self->parent->cpu->request_interrupt(self->parent->cpu, IT_LCD_STAT);
+    }
+
+    if (self->parent->context->hw_mode == HW_CGB
+        && self->parent->lcd->context->hdma.active
+        && self->parent->lcd->context->hdma.hblank_mode
+        && self->parent->lcd->context->y_coord < Y_RES) {
+        self->parent->scheduler->schedule(
+            self->parent->scheduler, EV_HDMA, self->parent->context->ticks);
     }
 }
 
@@ -293,7 +468,13 @@ const PPUClass init_ppu = {
     .oam_read = oam_read,
     .vram_write = vram_write,
     .vram_read = vram_read,
+    .touch_tile = touch_tile,
+    .publish = publish,
+    .present = present,
+    .fallback = fallback,
     .tick = tick,
+    .sync = sync,
+    .schedule = schedule,
     .increment_y = increment_y,
     .mode_hblank = mode_hblank,
     .mode_vblank = mode_vblank,
@@ -0,0 +1,299 @@
+#include "../include/gameboy.h"
+
+static void constructor(void *ptr, va_list *args)
+{
+    RewindClass *self = (RewindClass *) ptr;
+    if (!((self->context = calloc(1, sizeof(*self->context))))) {
+        HANDLE_ERROR("failed memory allocation");
+    }
+    self->parent = va_arg(*args, GameboyClass *);
+    self->context->base_seq = STATE_NONE;
+#ifndef HEADLESS
+    self->context->enabled = true;
+#endif
+}
+
+static void destructor(void *ptr)
+{
+    RewindClass *self = (RewindClass *) ptr;
+    free(self->context->ring);
+    free(self->context->snapshot);
+    free(self->context->base);
+    free(self->context);
+}
+
+static size_t put_varint(uint8_t *out, size_t value)
+{
+    size_t n = 0;
+
+    while (value >= 0x80) {
+        out[n++] = (value & 0x7F) | 0x80;
+        value >>= 7;
+    }
+    out[n++] = value;
+
+    return n;
+}
+
+static size_t get_varint(const uint8_t *in, size_t *value)
+{
+    size_t n = 0;
+    uint32_t shift = 0;
+
+    *value = 0;
+    do {
+        *value |= (size_t) (in[n] & 0x7F) << shift;
+        shift += 7;
+    } while (in[n++] & 0x80);
+
+    return n;
+}
+
+/*
+ * XORs data against base (zeros for a keyframe) and packs the result as
+ * runs of unchanged words followed by literal words, so a frame where WRAM
+ * and VRAM barely moved costs a few hundred bytes.
+ */
+static size_t encode(
+    const uint64_t *data, const uint64_t *base, size_t words, uint8_t *out)
+{
+    size_t n = 0;
+    size_t i = 0;
+
+    while (i < words) {
+        size_t zeros = i;
+        while (i < words && data[i] == (base ? base[i] : 0)) {
+            i++;
+        }
+
+        size_t literal = i;
+        while (i < words && data[i] != (base ? base[i] : 0)) {
+            i++;
+        }
+
+        n += put_varint(out + n, literal - zeros);
+        n += put_varint(out + n, i - literal);
+
+        for (size_t j = literal; j < i; j++) {
+            uint64_t value = data[j] ^ (base ? base[j] : 0);
+            memcpy(out + n, &value, sizeof(value));
+            n += sizeof(value);
+        }
+    }
+    return n;
+}
+
+static void decode(const uint8_t *in, size_t length, uint64_t *out)
+{
+    size_t n = 0;
+    size_t i = 0;
+
+    while (n < length) {
+        size_t zeros = 0;
+        size_t literal = 0;
+
+        n += get_varint(in + n, &zeros);
+        n += get_varint(in + n, &literal);
+        i += zeros;
+
+        for (size_t j = 0; j < literal; j++, i++) {
+            uint64_t value;
+            memcpy(&value, in + n, sizeof(value));
+            out[i] ^= value;
+            n += sizeof(value);
+        }
+    }
+}
+
+static rewind_entry_t *entry(RewindClass *self, uint32_t seq)
+{
+    return &self->context->entries[seq % REWIND_FRAMES];
+}
+
+/* Drops the oldest keyframe together with the deltas that depend on it */
+static void evict(RewindClass *self)
+{
+    rewind_context_t *context = self->context;
+
+    do {
+        context->first++;
+        context->count--;
+    } while (context->count
+        && entry(self, context->first)->keyframe != context->first);
+
+    if (context->base_seq < context->first) {
+        context->base_seq = STATE_NONE;
+    }
+}
+
+static void allocate(RewindClass *self)
+{
+    rewind_context_t *context = self->context;
+
+    context->state_size = self->parent->state->save_chunks(
+        self->parent->state, NULL, 0, STATE_NO_VIDEO);
+    context->words = (context->state_size + 7) / 8;
+
+    if (!((context->ring = malloc(REWIND_CAPACITY)))
+        || !((context->snapshot = calloc(context->words, 8)))
+        || !((context->base = calloc(context->words, 8)))) {
+        HANDLE_ERROR("failed memory allocation");
+    }
+}
+
+static void record(RewindClass *self)
+{
+    rewind_context_t *context = self->context;
+
+    if (!context->ring) {
+        allocate(self);
+    }
+
+    self->parent->state->save_chunks(self->parent->state,
+        (uint8_t *) context->snapshot, context->state_size, STATE_NO_VIDEO);
+
+    if (context->count == REWIND_FRAMES) {
+        self->evict(self);
+    }
+
+    /* reserve the worst case, then pack straight into the ring */
+    size_t reserve = context->words * 16 + 16;
+
+    if (context->write + reserve > REWIND_CAPACITY) {
+        while (context->count
+            && entry(self, context->first)->offset >= context->write) {
+            self->evict(self);
+        }
+        context->write = 0;
+    }
+
+    while (context->count) {
+        rewind_entry_t *oldest = entry(self, context->first);
+        if (oldest->offset >= context->write + reserve
+            || context->write >= oldest->offset + oldest->length) {
+            break;
+        }
+        self->evict(self);
+    }
+
+    uint32_t seq = context->first + context->count;
+    bool keyframe = context->base_seq == STATE_NONE
+        || seq - context->base_seq >= REWIND_KEYFRAME;
+    uint8_t *out = context->ring + context->write;
+    size_t length = encode(context->snapshot, keyframe ? NULL : context->base,
+        context->words, out);
+
+    if (keyframe) {
+        memcpy(context->base, context->snapshot, context->words * 8);
+        context->base_seq = seq;
+    }
+
+    *entry(self, seq) = (rewind_entry_t) {
+        .offset = context->write,
+        .length = length,
+        .keyframe = context->base_seq,
+    };
+    context->write += length;
+    context->count++;
+}
+
+static void restore(RewindClass *self, uint32_t seq)
+{
+    rewind_context_t *context = self->context;
+    rewind_entry_t *target = entry(self, seq);
+
+    if (context->base_seq != target->keyframe) {
+        rewind_entry_t *keyframe = entry(self, target->keyframe);
+        memset(context->base, 0, context->words * 8);
+        decode(context->ring + keyframe->offset, keyframe->length,
+            context->base);
+        context->base_seq = target->keyframe;
+    }
+
+    memcpy(context->snapshot, context->base, context->words * 8);
+    if (seq != target->keyframe) {
+        decode(context->ring + target->offset, target->length,
+            context->snapshot);
+    }
+
+    if (!self->parent->state->load(self->parent->state,
+            (const uint8_t *) context->snapshot, context->state_size)) {
+        LOG("Failed to restore rewind snapshot");
+    }
+}
+
+static void drop(RewindClass *self)
+{
+    rewind_context_t *context = self->context;
+    uint32_t seq = context->first + context->count - 1;
+
+    context->write = entry(self, seq)->offset;
+    context->count--;
+
+    if (context->base_seq == seq) {
+        context->base_seq = STATE_NONE;
+    }
+}
+
+/*
+ * Snapshots are taken without the framebuffer, so a step back restores the
+ * frame before the target and emulates it once to redraw the screen.
+ */
+static void step_back(RewindClass *self)
+{
+    rewind_context_t *context = self->context;
+
+    if (!context->count) {
+        return;
+    }
+
+    uint32_t seq = context->first + context->count - 1;
+
+    self->restore(self, context->count > 1 ? seq - 1 : seq);
+    self->parent->run_frames(self->parent, 1);
+
+    if (context->count > 1) {
+        self->drop(self);
+    }
+}
+
+static void frame(RewindClass *self)
+{
+    uint32_t current_frame = self->parent->ppu->context->current_frame;
+
+    if (current_frame == self->context->last_frame) {
+        return;
+    }
+
+    if (self->context->enabled) {
+        if (self->context->rewinding) {
+            self->step_back(self);
+        } else {
+            self->record(self);
+        }
+    }
+    self->context->last_frame = self->parent->ppu->context->current_frame;
+}
+
+static void set_rewinding(RewindClass *self, bool rewinding)
+{
+    self->context->rewinding = rewinding;
+}
+
+const RewindClass init_rewind = {
+    {
+        ._size = sizeof(RewindClass),
+        ._name = "Rewind",
+        ._constructor = constructor,
+        ._destructor = destructor,
+    },
+    .frame = frame,
+    .record = record,
+    .step_back = step_back,
+    .restore = restore,
+    .drop = drop,
+    .evict = evict,
+    .set_rewinding = set_rewinding,
+};
+
+const class_t *Rewind = (const class_t *) &init_rewind;
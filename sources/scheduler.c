@@ -0,0 +1,186 @@
+#include "../include/gameboy.h"
+
+static void constructor(void *ptr, va_list *args)
+{
+    SchedulerClass *self = (SchedulerClass *) ptr;
+    if (!((self->context = calloc(1, sizeof(*self->context))))) {
+        HANDLE_ERROR("failed memory allocation");
+    }
+    self->parent = va_arg(*args, GameboyClass *);
+    for (int32_t i = 0; i < EV_COUNT; i++) {
+        self->context->position[i] = -1;
+    }
+}
+
+static void destructor(void *ptr)
+{
+    SchedulerClass *self = (SchedulerClass *) ptr;
+    free(self->context);
+}
+
+static bool before(event_t *a, event_t *b)
+{
+    if (a->deadline != b->deadline) {
+        return a->deadline < b->deadline;
+    }
+    return a->type < b->type;
+}
+
+static void swap(SchedulerClass *self, int32_t a, int32_t b)
+{
+    event_t tmp = self->context->heap[a];
+
+    self->context->heap[a] = self->context->heap[b];
+    self->context->heap[b] = tmp;
+    self->context->position[self->context->heap[a].type] = a;
+    self->context->position[self->context->heap[b].type] = b;
+}
+
+static void sift_up(SchedulerClass *self, int32_t index)
+{
+    while (index > 0) {
+        int32_t parent = (index - 1) / 2;
+        if (!before(
+                &self->context->heap[index], &self->context->heap[parent])) {
+            break;
+        }
+        swap(self, index, parent);
+        index = parent;
+    }
+}
+
+static void sift_down(SchedulerClass *self, int32_t index)
+{
+    for (;;) {
+        int32_t left = (index * 2) + 1;
+        int32_t right = left + 1;
+        int32_t smallest = index;
+
+        if (left < self->context->size
+            && before(&self->context->heap[left],
+                &self->context->heap[smallest])) {
+            smallest = left;
+        }
+        if (right < self->context->size
+            && before(&self->context->heap[right],
+                &self->context->heap[smallest])) {
+            smallest = right;
+        }
+        if (smallest == index) {
+            break;
+        }
+        swap(self, index, smallest);
+        index = smallest;
+    }
+}
+
+static void schedule(
+    SchedulerClass *self, event_type_t type, uint64_t deadline)
+{
+    int32_t index = self->context->position[type];
+
+    if (index < 0) {
+        index = self->context->size++;
+        self->context->heap[index].type = type;
+        self->context->position[type] = index;
+    }
+    self->context->heap[index].deadline = deadline;
+    sift_up(self, index);
+    sift_down(self, self->context->position[type]);
+}
+
+static void cancel(SchedulerClass *self, event_type_t type)
+{
+    int32_t index = self->context->position[type];
+
+    if (index < 0) {
+        return;
+    }
+
+    int32_t last = --self->context->size;
+
+    self->context->position[type] = -1;
+    if (index == last) {
+        return;
+    }
+    self->context->heap[index] = self->context->heap[last];
+    self->context->position[self->context->heap[index].type] = index;
+    sift_up(self, index);
+    sift_down(self, self->context->position[self->context->heap[index].type]);
+}
+
+static bool pending(SchedulerClass *self, event_type_t type)
+{
+    return self->context->position[type] >= 0;
+}
+
+static uint64_t next(SchedulerClass *self)
+{
+    if (!self->context->size) {
+        return UINT64_MAX;
+    }
+    return self->context->heap[0].deadline;
+}
+
+static uint64_t horizon(SchedulerClass *self, event_type_t type)
+{
+    uint64_t limit = self->context->target;
+
+    if (self->context->size && self->context->heap[0].deadline <= limit) {
+        limit = self->context->heap[0].deadline;
+        if (self->context->heap[0].type < type) {
+            limit -= 1;
+        }
+    }
+    return limit;
+}
+
+static void dispatch(SchedulerClass *self, event_type_t type)
+{
+    switch (type) {
+        case EV_TIMER: self->parent->timer->tick(self->parent->timer); break;
+        case EV_PPU: self->parent->ppu->tick(self->parent->ppu); break;
+        case EV_HDMA:
+            self->parent->lcd->hdma_hblank(self->parent->lcd);
+            break;
+        case EV_DMA: self->parent->dma->tick(self->parent->dma); break;
+        case EV_SERIAL:
+            self->parent->io->serial_tick(self->parent->io);
+            break;
+        case EV_SOUND: self->parent->sound->tick(self->parent->sound); break;
+        default: {
+            HANDLE_ERROR("Invalid scheduler event");
+        }
+    }
+}
+
+static void run(SchedulerClass *self, uint64_t target)
+{
+    self->context->target = target;
+    while (self->context->size && self->context->heap[0].deadline <= target) {
+        event_t event = self->context->heap[0];
+
+        self->cancel(self, event.type);
+        self->parent->context->ticks = event.deadline;
+        self->dispatch(self, event.type);
+    }
+    self->parent->context->ticks = target;
+}
+
+const SchedulerClass init_scheduler = {
+    {
+        ._size = sizeof(SchedulerClass),
+        ._name = "Scheduler",
+        ._constructor = constructor,
+        ._destructor = destructor,
+    },
+    .schedule = schedule,
+    .cancel = cancel,
+    .pending = pending,
+    .next = next,
+    .horizon = horizon,
+    .run = run,
+    .dispatch = dispatch,
+};
+
+const class_t *Scheduler = (const class_t *) &init_scheduler;
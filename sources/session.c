@@ -25,10 +25,7 @@ static void constructor(void *ptr, va_list *args)
         return;
     }
 
-    bool cgb = gameboy->cartridge->context->header->cgb_flag & 0x80;
-    gameboy->context->hw_mode = cgb ? HW_CGB : HW_DMG;
-    gameboy->cpu->context->registers.a = cgb ? 0x11 : 0x01;
-    gameboy->context->prev_frame = 0;
+    gameboy->boot(gameboy);
 
     if (pthread_create(&self->thread, NULL, gameboy->cpu_run, gameboy) != 0) {
         destroy_class(gameboy);
@@ -36,7 +33,6 @@ static void constructor(void *ptr, va_list *args)
     }
 
     self->set(self, gameboy);
-    LOG(cgb ? "Running in CGB mode" : "Running in DMG mode");
 }
 
 static void destructor(void *ptr)
@@ -1,5 +1,7 @@
 #include "../include/sound.h"
-#include <SDL2/SDL.h>
+#ifndef HEADLESS
+    #include <SDL2/SDL.h>
+#endif
 #include <math.h>
 #include "../include/gameboy.h"
 
@@ -15,33 +17,13 @@ static void constructor(void *ptr, va_list *args)
     self->context->channel_control = 0xF3;
     self->context->master_on = 0x80;
 
-    self->context->channel1.period = 0;
-    self->context->channel1.duty_cycle = 0;
-    self->context->channel1.volume = 0;
-    self->context->channel1.time_counter = 0;
-    self->context->channel1.envelope_counter = 0;
-    self->context->channel1.sweep_counter = 0;
-    self->context->channel1.lfsr = 0x7FFF;
-
-    self->context->channel2.period = 0;
-    self->context->channel2.duty_cycle = 0;
-    self->context->channel2.volume = 0;
-    self->context->channel2.time_counter = 0;
-    self->context->channel2.envelope_counter = 0;
-
-    self->context->channel3.period = 0;
-    self->context->channel3.volume = 0;
-    self->context->channel3.time_counter = 0;
-    memset(self->context->channel3.wave_pattern, 0,
-        sizeof(self->context->channel3.wave_pattern));
-
-    self->context->channel4.period = 0;
-    self->context->channel4.volume = 0;
     self->context->channel4.lfsr = 0x7FFF;
-    self->context->channel4.time_counter = 0;
-    self->context->channel4.envelope_counter = 0;
+    self->context->rate = AUDIO_FREQUENCY;
 
+    self->init_kernel(self);
+    self->init_lfsr(self);
     self->init_sound_system(self);
+    self->schedule(self);
 
     LOG("Sound system initialized");
 }
@@ -50,94 +32,165 @@ static void destructor(void *ptr)
 {
     SoundClass *self = (SoundClass *) ptr;
 
+#ifndef HEADLESS
     if (self->context->initialized) {
         SDL_CloseAudioDevice(self->context->device);
     }
+#endif
 
     free(self->context);
 }
 
-static float_t get_channel1_sample(SoundClass *self)
+/*
+ * Channel outputs are signed amplitudes where a full-volume channel swings
+ * between -30 and 30, so every channel is centred around zero.
+ */
+static int32_t get_channel1_sample(SoundClass *self)
 {
     sound_channel1_t *channel = &self->context->channel1;
-    if (channel->volume == 0 || channel->period == 0) {
-        return 0.0f;
+    if (!channel->enabled || channel->volume == 0) {
+        return 0;
     }
 
-    float_t cycle_pos =
-        fmodf(channel->time_counter, 1.0f / channel->period) * channel->period;
+    int32_t amplitude = channel->volume * 2;
 
-    float_t sample = 0.0f;
-
-    switch (channel->wave_duty) {
-        case 0: sample = (cycle_pos < 0.125f) ? 1.0f : -1.0f; break;
-        case 1: sample = (cycle_pos < 0.25f) ? 1.0f : -1.0f; break;
-        case 2: sample = (cycle_pos < 0.5f) ? 1.0f : -1.0f; break;
-        case 3: sample = (cycle_pos < 0.75f) ? 1.0f : -1.0f; break;
-    }
-
-    return sample * (channel->volume / 15.0f);
+    return ((self->duty_waveforms[channel->wave_duty] >> channel->duty_step)
+               & 0x01)
+        ? amplitude
+        : -amplitude;
 }
 
-static float_t get_channel2_sample(SoundClass *self)
+static int32_t get_channel2_sample(SoundClass *self)
 {
     sound_channel2_t *channel = &self->context->channel2;
-    if (channel->volume == 0 || channel->period == 0) {
-        return 0.0f;
+    if (!channel->enabled || channel->volume == 0) {
+        return 0;
     }
 
-    float_t cycle_pos =
-        fmodf(channel->time_counter, 1.0f / channel->period) * channel->period;
+    int32_t amplitude = channel->volume * 2;
 
-    float_t sample = 0.0f;
+    return ((self->duty_waveforms[channel->wave_duty] >> channel->duty_step)
+               & 0x01)
+        ? amplitude
+        : -amplitude;
+}
 
-    switch (channel->wave_duty) {
-        case 0: sample = (cycle_pos < 0.125f) ? 1.0f : -1.0f; break;
-        case 1: sample = (cycle_pos < 0.25f) ? 1.0f : -1.0f; break;
-        case 2: sample = (cycle_pos < 0.5f) ? 1.0f : -1.0f; break;
-        case 3: sample = (cycle_pos < 0.75f) ? 1.0f : -1.0f; break;
+static int32_t get_channel3_sample(SoundClass *self)
+{
+    sound_channel3_t *channel = &self->context->channel3;
+    if (!channel->enabled || channel->volume == 0) {
+        return 0;
     }
 
-    return sample * (channel->volume / 15.0f);
+    uint8_t sample_byte = channel->wave_pattern[channel->position / 2];
+    int32_t raw_sample = (channel->position % 2 == 0)
+        ? ((sample_byte >> 4) & 0x0F)
+        : (sample_byte & 0x0F);
+
+    return ((raw_sample * 4) - 30) * channel->volume / 15;
 }
 
-static float_t get_channel3_sample(SoundClass *self)
+static int32_t get_channel4_sample(SoundClass *self)
 {
-    sound_channel3_t *channel = &self->context->channel3;
-    if (channel->volume == 0 || channel->period == 0) {
-        return 0.0f;
+    sound_channel4_t *channel = &self->context->channel4;
+    if (!channel->enabled || channel->volume == 0) {
+        return 0;
     }
 
-    float_t cycle_pos =
-        fmodf(channel->time_counter, 1.0f / channel->period) * channel->period;
-    int32_t pattern_pos = (int32_t) (cycle_pos * 32) % 32;
+    int32_t amplitude = channel->volume * 2;
+
+    return (channel->lfsr & 0x1) ? amplitude : -amplitude;
+}
+
+/*
+ * One windowed-sinc impulse per sub-sample phase, normalised so that each
+ * phase sums to exactly 1 << BLIP_BITS and integrating never drifts.
+ */
+static void init_kernel(SoundClass *self)
+{
+    const float_t pi = acosf(-1.0f);
+    const float_t cutoff = 0.9f;
+
+    for (int32_t phase = 0; phase < BLIP_PHASES; phase++) {
+        int16_t *kernel = self->context->blip.kernel[phase];
+        float_t taps[BLIP_TAPS];
+        float_t total = 0;
+        int32_t sum = 0;
+
+        for (int32_t i = 0; i < BLIP_TAPS; i++) {
+            float_t x = i - ((BLIP_TAPS - 1) / 2.0f)
+                - ((float_t) phase / BLIP_PHASES);
+            float_t angle = pi * cutoff * x;
+            float_t sinc = fabsf(angle) < 1e-6f ? 1.0f : sinf(angle) / angle;
+            float_t window = 0.42f + (0.5f * cosf(pi * x / (BLIP_TAPS / 2)))
+                + (0.08f * cosf(2.0f * pi * x / (BLIP_TAPS / 2)));
+
+            taps[i] = sinc * window;
+            total += taps[i];
+        }
 
-    int32_t sample_byte = pattern_pos / 2;
-    int32_t sample_nibble = pattern_pos % 2;
+        for (int32_t i = 0; i < BLIP_TAPS; i++) {
+            kernel[i] = (int16_t) lroundf(taps[i] / total * (1 << BLIP_BITS));
+            sum += kernel[i];
+        }
+        kernel[BLIP_TAPS / 2] += (1 << BLIP_BITS) - sum;
+    }
+}
 
-    int32_t raw_sample = (sample_nibble == 0)
-        ? ((channel->wave_pattern[sample_byte] >> 4) & 0x0F)
-        : (channel->wave_pattern[sample_byte] & 0x0F);
+static uint16_t clock_lfsr(uint16_t lfsr, bool short_width)
+{
+    uint8_t bit = (lfsr & 0x1) ^ ((lfsr >> 1) & 0x1);
 
-    float_t sample = (raw_sample / 7.5f) - 1.0f;
+    lfsr >>= 1;
+    lfsr |= (bit << 14);
 
-    return sample * (channel->volume / 15.0f);
+    if (short_width) {
+        lfsr &= ~(1 << 6);
+        lfsr |= (bit << 6);
+    }
+    return lfsr;
 }
 
-static float_t get_channel4_sample(SoundClass *self)
+/* Applies a table row: the XOR of what each set bit alone becomes */
+static uint16_t apply_lfsr(const uint16_t jump[LFSR_BITS], uint16_t lfsr)
 {
-    sound_channel4_t *channel = &self->context->channel4;
-    if (channel->volume == 0 || channel->period == 0) {
-        return 0.0f;
+    uint16_t result = 0;
+
+    for (int32_t b = 0; lfsr; b++, lfsr >>= 1) {
+        if (lfsr & 0x1) {
+            result ^= jump[b];
+        }
     }
+    return result;
+}
 
-    float_t sample = (channel->lfsr & 0x1) ? 1.0f : -1.0f;
+/*
+ * A clock is linear over GF(2) in either width, so lfsr_jump[width][k]
+ * holds what each state bit alone becomes after 1 << k clocks and any
+ * number of clocks is at most LFSR_JUMPS table applications.
+ */
+static void init_lfsr(SoundClass *self)
+{
+    for (int32_t width = 0; width < 2; width++) {
+        uint16_t (*jump)[LFSR_BITS] = self->context->lfsr_jump[width];
 
-    return sample * (channel->volume / 15.0f);
+        for (int32_t b = 0; b < LFSR_BITS; b++) {
+            jump[0][b] = clock_lfsr(1 << b, width);
+        }
+        for (int32_t k = 1; k < LFSR_JUMPS; k++) {
+            for (int32_t b = 0; b < LFSR_BITS; b++) {
+                jump[k][b] = apply_lfsr(jump[k - 1], jump[k - 1][b]);
+            }
+        }
+    }
 }
 
 static void init_sound_system(SoundClass *self)
 {
+#ifdef HEADLESS
+    /* no device: the host drains the ring through gb_get_audio */
+    self->context->initialized = false;
+#else
     if (!(SDL_WasInit(SDL_INIT_AUDIO) & SDL_INIT_AUDIO)) {
         if (SDL_InitSubSystem(SDL_INIT_AUDIO) < 0) {
             fprintf(stderr, "SDL Audio initialization failed: %s\n",
@@ -164,11 +217,12 @@ static void init_sound_system(SoundClass *self)
 
     SDL_PauseAudioDevice(self->context->device, 0);
     self->context->initialized = true;
+#endif
 }
 
 static uint8_t read(SoundClass *self, uint16_t address)
 {
-    SDL_LockAudioDevice(self->context->device);
+    self->sync(self);
 
     uint8_t value = 0xFF;
 
@@ -281,7 +335,6 @@ static uint8_t read(SoundClass *self, uint16_t address)
         }
     }
 
-    SDL_UnlockAudioDevice(self->context->device);
     return value;
 }
 
@@ -291,7 +344,7 @@ static void write(SoundClass *self, uint16_t address, uint8_t value)
         return;
     }
 
-    SDL_LockAudioDevice(self->context->device);
+    self->sync(self);
 
     switch (address) {
         case 0xFF10: {
@@ -304,6 +357,8 @@ static void write(SoundClass *self, uint16_t address, uint8_t value)
             self->context->channel1.wave_duty =
                 self->duty_cycles[(value >> 6) & 0x03];
             self->context->channel1.length = value & 0x3F;
+            self->context->channel1.length_counter =
+                64 - self->context->channel1.length;
             break;
         }
         case 0xFF12: {
@@ -313,7 +368,8 @@ static void write(SoundClass *self, uint16_t address, uint8_t value)
 
             self->context->channel1.volume =
                 self->context->channel1.initial_volume;
-            self->context->channel1.envelope_counter = 0;
+            self->context->channel1.envelope_timer =
+                self->context->channel1.envelope_sweep;
 
             if (self->context->channel1.initial_volume == 0
                 && self->context->channel1.envelope_direction == 0) {
@@ -326,26 +382,40 @@ static void write(SoundClass *self, uint16_t address, uint8_t value)
             self->context->channel1.frequency =
                 ((self->context->channel1.freq_hi & 0x07) << 8) | value;
             self->context->channel1.period =
-                131072 / (2048 - self->context->channel1.frequency);
+                (2048 - self->context->channel1.frequency) * 4;
             break;
         }
         case 0xFF14: {
             bool trigger = (value >> 7) & 0x01;
             self->context->channel1.freq_hi = value & 0x07;
+            self->context->channel1.length_enabled = (value & 0x40) != 0;
 
             self->context->channel1.frequency =
                 ((self->context->channel1.freq_hi & 0x07) << 8)
                 | self->context->channel1.freq_lo;
             self->context->channel1.period =
-                131072 / (2048 - self->context->channel1.frequency);
+                (2048 - self->context->channel1.frequency) * 4;
 
             if (trigger) {
-                self->context->channel1.enabled = true;
-                self->context->channel1.volume =
-                    self->context->channel1.initial_volume;
-                self->context->channel1.time_counter = 0;
-                self->context->channel1.envelope_counter = 0;
-                self->context->channel1.sweep_counter = 0;
+                sound_channel1_t *channel = &self->context->channel1;
+
+                channel->enabled = true;
+                channel->volume = channel->initial_volume;
+                channel->timer = channel->period;
+                channel->envelope_timer = channel->envelope_sweep;
+                if (channel->length_counter == 0) {
+                    channel->length_counter = 64;
+                }
+
+                channel->shadow_frequency = channel->frequency;
+                channel->sweep_timer =
+                    channel->sweep_time ? channel->sweep_time : 8;
+                channel->sweep_enabled =
+                    channel->sweep_time || channel->sweep_shift;
+                if (channel->sweep_shift
+                    && self->sweep_frequency(self) > 2047) {
+                    channel->enabled = false;
+                }
             }
             break;
         }
@@ -353,6 +423,8 @@ static void write(SoundClass *self, uint16_t address, uint8_t value)
             self->context->channel2.wave_duty =
                 self->duty_cycles[(value >> 6) & 0x03];
             self->context->channel2.length = value & 0x3F;
+            self->context->channel2.length_counter =
+                64 - self->context->channel2.length;
             break;
         }
         case 0xFF17: {
@@ -362,7 +434,8 @@ static void write(SoundClass *self, uint16_t address, uint8_t value)
 
             self->context->channel2.volume =
                 self->context->channel2.initial_volume;
-            self->context->channel2.envelope_counter = 0;
+            self->context->channel2.envelope_timer =
+                self->context->channel2.envelope_sweep;
 
             if (self->context->channel2.initial_volume == 0
                 && self->context->channel2.envelope_direction == 0) {
@@ -375,25 +448,30 @@ static void write(SoundClass *self, uint16_t address, uint8_t value)
             self->context->channel2.frequency =
                 ((self->context->channel2.freq_hi & 0x07) << 8) | value;
             self->context->channel2.period =
-                131072 / (2048 - self->context->channel2.frequency);
+                (2048 - self->context->channel2.frequency) * 4;
             break;
         }
         case 0xFF19: {
             bool trigger = (value >> 7) & 0x01;
             self->context->channel2.freq_hi = value & 0x07;
+            self->context->channel2.length_enabled = (value & 0x40) != 0;
 
             self->context->channel2.frequency =
                 ((self->context->channel2.freq_hi & 0x07) << 8)
                 | self->context->channel2.freq_lo;
             self->context->channel2.period =
-                131072 / (2048 - self->context->channel2.frequency);
+                (2048 - self->context->channel2.frequency) * 4;
 
             if (trigger) {
-                self->context->channel2.enabled = true;
-                self->context->channel2.volume =
-                    self->context->channel2.initial_volume;
-                self->context->channel2.time_counter = 0;
-                self->context->channel2.envelope_counter = 0;
+                sound_channel2_t *channel = &self->context->channel2;
+
+                channel->enabled = true;
+                channel->volume = channel->initial_volume;
+                channel->timer = channel->period;
+                channel->envelope_timer = channel->envelope_sweep;
+                if (channel->length_counter == 0) {
+                    channel->length_counter = 64;
+                }
             }
             break;
         }
@@ -403,6 +481,7 @@ static void write(SoundClass *self, uint16_t address, uint8_t value)
         }
         case 0xFF1B: {
             self->context->channel3.length = value;
+            self->context->channel3.length_counter = 256 - value;
             break;
         }
         case 0xFF1C: {
@@ -417,27 +496,36 @@ static void write(SoundClass *self, uint16_t address, uint8_t value)
             self->context->channel3.frequency =
                 ((self->context->channel3.freq_hi & 0x07) << 8) | value;
             self->context->channel3.period =
-                131072 / (2048 - self->context->channel3.frequency) / 2;
+                (2048 - self->context->channel3.frequency) * 2;
             break;
         }
         case 0xFF1E: {
             bool trigger = (value >> 7) & 0x01;
             self->context->channel3.freq_hi = value & 0x07;
+            self->context->channel3.length_enabled = (value & 0x40) != 0;
 
             self->context->channel3.frequency =
                 ((self->context->channel3.freq_hi & 0x07) << 8)
                 | self->context->channel3.freq_lo;
             self->context->channel3.period =
-                131072 / (2048 - self->context->channel3.frequency) / 2;
+                (2048 - self->context->channel3.frequency) * 2;
 
             if (trigger) {
-                self->context->channel3.enabled = true;
-                self->context->channel3.time_counter = 0;
+                sound_channel3_t *channel = &self->context->channel3;
+
+                channel->enabled = true;
+                channel->position = 0;
+                channel->timer = channel->period;
+                if (channel->length_counter == 0) {
+                    channel->length_counter = 256;
+                }
             }
             break;
         }
         case 0xFF20: {
             self->context->channel4.length = value & 0x3F;
+            self->context->channel4.length_counter =
+                64 - self->context->channel4.length;
             break;
         }
         case 0xFF21: {
@@ -447,7 +535,8 @@ static void write(SoundClass *self, uint16_t address, uint8_t value)
 
             self->context->channel4.volume =
                 self->context->channel4.initial_volume;
-            self->context->channel4.envelope_counter = 0;
+            self->context->channel4.envelope_timer =
+                self->context->channel4.envelope_sweep;
 
             if (self->context->channel4.initial_volume == 0
                 && self->context->channel4.envelope_direction == 0) {
@@ -470,14 +559,19 @@ static void write(SoundClass *self, uint16_t address, uint8_t value)
         }
         case 0xFF23: {
             bool trigger = (value >> 7) & 0x01;
+            self->context->channel4.length_enabled = (value & 0x40) != 0;
 
             if (trigger) {
-                self->context->channel4.enabled = true;
-                self->context->channel4.volume =
-                    self->context->channel4.initial_volume;
-                self->context->channel4.time_counter = 0;
-                self->context->channel4.envelope_counter = 0;
-                self->context->channel4.lfsr = 0x7FFF;
+                sound_channel4_t *channel = &self->context->channel4;
+
+                channel->enabled = true;
+                channel->volume = channel->initial_volume;
+                channel->timer = channel->period;
+                channel->envelope_timer = channel->envelope_sweep;
+                channel->lfsr = 0x7FFF;
+                if (channel->length_counter == 0) {
+                    channel->length_counter = 64;
+                }
             }
             break;
         }
@@ -517,7 +611,8 @@ static void write(SoundClass *self, uint16_t address, uint8_t value)
         }
     }
 
-    SDL_UnlockAudioDevice(self->context->device);
+    /* register writes take effect on the output straight away */
+    self->mix(self, self->context->last_sync);
 }
 
 static void update(SoundClass *self)
@@ -527,212 +622,499 @@ static void update(SoundClass *self)
     }
 }
 
-static void audio_callback(void *userdata, uint8_t *stream, int32_t len)
+/* Feeds the change of the stereo output at time into the step buffer */
+static void mix(SoundClass *self, uint64_t time)
 {
-    SoundClass *self = (SoundClass *) userdata;
-    int16_t *buffer = (int16_t *) stream;
-    int32_t sample_count = len / 4;
+    blip_buffer_t *blip = &self->context->blip;
+    int32_t samples[4] = {
+        self->get_channel1_sample(self),
+        self->get_channel2_sample(self),
+        self->get_channel3_sample(self),
+        self->get_channel4_sample(self),
+    };
+    int32_t left = 0;
+    int32_t right = 0;
+
+    for (int32_t i = 0; i < 4; i++) {
+        if (self->context->channel_control & (0x01 << i)) {
+            left += samples[i];
+        }
+        if (self->context->channel_control & (0x10 << i)) {
+            right += samples[i];
+        }
+    }
 
-    if (!(self->context->master_on & 0x80)) {
-        memset(stream, 0, len);
-        return;
+    left *= (self->context->master_volume >> 4) & 0x07;
+    right *= self->context->master_volume & 0x07;
+
+    if (left != blip->level[0] || right != blip->level[1]) {
+        self->add_delta(
+            self, time, left - blip->level[0], right - blip->level[1]);
+        blip->level[0] = left;
+        blip->level[1] = right;
     }
+}
 
-    float_t dt = 1.0f / AUDIO_FREQUENCY;
+/* Same as mix when only one channel moved and panning is unchanged */
+static void output(
+    SoundClass *self, uint8_t channel, int32_t delta, uint64_t time)
+{
+    blip_buffer_t *blip = &self->context->blip;
+    int32_t left = (self->context->channel_control & (0x01 << channel))
+        ? delta * ((self->context->master_volume >> 4) & 0x07)
+        : 0;
+    int32_t right = (self->context->channel_control & (0x10 << channel))
+        ? delta * (self->context->master_volume & 0x07)
+        : 0;
+
+    if (left || right) {
+        self->add_delta(self, time, left, right);
+        blip->level[0] += left;
+        blip->level[1] += right;
+    }
+}
 
-    for (int32_t i = 0; i < sample_count; i++) {
-        float_t left_sample = 0;
-        float_t right_sample = 0;
+static void add_delta(SoundClass *self, uint64_t time, int32_t left,
+    int32_t right)
+{
+    blip_buffer_t *blip = &self->context->blip;
+    uint64_t position =
+        ((time - self->context->last_sync) * self->context->rate)
+        + self->context->sample_phase;
+    uint32_t index = position / DOTS_PER_SECOND;
+    const int16_t *kernel = blip->kernel[(position % DOTS_PER_SECOND)
+        * BLIP_PHASES / DOTS_PER_SECOND];
+
+    for (int32_t i = 0; i < BLIP_TAPS; i++) {
+        blip->buffer[index + i][0] += left * kernel[i];
+        blip->buffer[index + i][1] += right * kernel[i];
+    }
+}
 
-        if (self->context->channel1.enabled) {
-            self->update_channel1(self, dt);
-            float_t sample = self->get_channel1_sample(self);
+/*
+ * Integrates every sample that no later delta can reach anymore, pushes
+ * them to the ring and moves the remaining kernel tails to the front.
+ */
+static void flush(SoundClass *self, uint64_t until)
+{
+    blip_buffer_t *blip = &self->context->blip;
+    uint64_t phase = ((until - self->context->last_sync) * self->context->rate)
+        + self->context->sample_phase;
+    uint32_t count = phase / DOTS_PER_SECOND;
 
-            if (self->context->channel_control & 0x01) {
-                left_sample += sample;
-            }
-            if (self->context->channel_control & 0x10) {
-                right_sample += sample;
-            }
-        }
+    self->context->sample_phase = phase % DOTS_PER_SECOND;
+    self->context->last_sync = until;
 
-        if (self->context->channel2.enabled) {
-            self->update_channel2(self, dt);
-            float_t sample = self->get_channel2_sample(self);
+    for (uint32_t i = 0; i < count; i++) {
+        int16_t frame[AUDIO_CHANNELS];
 
-            if (self->context->channel_control & 0x02) {
-                left_sample += sample;
-            }
-            if (self->context->channel_control & 0x20) {
-                right_sample += sample;
-            }
+        for (int32_t c = 0; c < AUDIO_CHANNELS; c++) {
+            blip->integrator[c] += blip->buffer[i][c];
+
+            int64_t sample = (int64_t) blip->integrator[c] * APU_OUTPUT_GAIN
+                / (1 << BLIP_BITS);
+            frame[c] = sample > INT16_MAX ? INT16_MAX
+                : sample < INT16_MIN     ? INT16_MIN
+                                         : (int16_t) sample;
         }
+        self->push(self, frame);
+    }
 
-        if (self->context->channel3.enabled) {
-            self->update_channel3(self, dt);
-            float_t sample = self->get_channel3_sample(self);
+    memmove(blip->buffer, blip->buffer + count,
+        BLIP_TAPS * sizeof(blip->buffer[0]));
+    memset(blip->buffer + BLIP_TAPS, 0, count * sizeof(blip->buffer[0]));
+}
 
-            if (self->context->channel_control & 0x04) {
-                left_sample += sample;
-            }
-            if (self->context->channel_control & 0x40) {
-                right_sample += sample;
-            }
-        }
+/*
+ * Single producer, single consumer: only the emulation thread moves head
+ * and only the audio callback moves tail. A full ring drops the new frame.
+ */
+static void push(SoundClass *self, const int16_t frame[AUDIO_CHANNELS])
+{
+    audio_ring_t *ring = &self->context->ring;
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
 
-        if (self->context->channel4.enabled) {
-            self->update_channel4(self, dt);
-            float_t sample = self->get_channel4_sample(self);
+    if (head - tail == AUDIO_RING_FRAMES) {
+        atomic_fetch_add_explicit(&ring->overruns, 1, memory_order_relaxed);
+        return;
+    }
 
-            if (self->context->channel_control & 0x08) {
-                left_sample += sample;
-            }
-            if (self->context->channel_control & 0x80) {
-                right_sample += sample;
-            }
+    memcpy(ring->frames[head % AUDIO_RING_FRAMES], frame,
+        sizeof(ring->frames[0]));
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+}
+
+/* Copies out up to count frames and returns how many were available */
+static size_t pop(SoundClass *self, int16_t *buffer, size_t count)
+{
+    audio_ring_t *ring = &self->context->ring;
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    uint32_t keep =
+        atomic_exchange_explicit(&ring->trim, 0, memory_order_relaxed);
+
+    if (keep && head - tail > keep) {
+        tail = head - keep;
+    }
+
+    size_t available = head - tail;
+
+    if (available > count) {
+        available = count;
+    }
+
+    for (size_t i = 0; i < available; i++) {
+        memcpy(buffer + (i * AUDIO_CHANNELS),
+            ring->frames[(tail + i) % AUDIO_RING_FRAMES],
+            sizeof(ring->frames[0]));
+    }
+    atomic_store_explicit(&ring->tail, tail + available, memory_order_release);
+
+    return available;
+}
+
+/*
+ * Output samples are produced on the emulation thread, one per
+ * DOTS_PER_SECOND / AUDIO_FREQUENCY ticks of emulated time, so what is
+ * heard depends only on the program and not on when the device asks.
+ * Channels are stepped up to each frame sequencer edge in turn, which also
+ * bounds how far ahead of the flushed samples a delta can land.
+ */
+static void sync(SoundClass *self)
+{
+    uint64_t now = self->parent->context->ticks;
+
+    self->mix(self, self->context->last_sync);
+
+    while (self->context->last_sync < now) {
+        uint64_t edge = ((self->context->last_sync / APU_FRAME_TICKS) + 1)
+            * APU_FRAME_TICKS;
+        uint64_t until = edge < now ? edge : now;
+
+        self->update_channel1(self, until);
+        self->update_channel2(self, until);
+        self->update_channel3(self, until);
+        self->update_channel4(self, until);
+
+        if (until == edge) {
+            self->sequence(self, edge);
         }
+        self->flush(self, until);
+    }
+}
 
-        float_t left_vol = ((self->context->master_volume >> 4) & 0x07) / 7.0f;
-        float_t right_vol = (self->context->master_volume & 0x07) / 7.0f;
+/* Frames generated but not yet taken by the device */
+static size_t buffered(SoundClass *self)
+{
+    audio_ring_t *ring = &self->context->ring;
 
-        left_sample *= left_vol;
-        right_sample *= right_vol;
+    return atomic_load_explicit(&ring->head, memory_order_relaxed)
+        - atomic_load_explicit(&ring->tail, memory_order_acquire);
+}
 
-        int16_t left_out =
-            (int16_t) (fmaxf(-1.0f, fminf(1.0f, left_sample)) * 32767.0f);
-        int16_t right_out =
-            (int16_t) (fmaxf(-1.0f, fminf(1.0f, right_sample)) * 32767.0f);
+/* Frames taken by the consumer so far, wrapping; it stops when it stalls */
+static uint32_t played(SoundClass *self)
+{
+    return atomic_load_explicit(
+        &self->context->ring.tail, memory_order_acquire);
+}
 
-        buffer[i * 2] = left_out;
-        buffer[i * 2 + 1] = right_out;
+/*
+ * Asks the consumer to drop all but the newest keep frames at its next
+ * pop, since only it may move tail. keep must not be 0.
+ */
+static void trim(SoundClass *self, uint32_t keep)
+{
+    atomic_store_explicit(
+        &self->context->ring.trim, keep, memory_order_relaxed);
+}
+
+/*
+ * Scales how many samples an emulated second produces, for rate control.
+ * Only called from the emulation thread, between syncs.
+ */
+static void set_rate(SoundClass *self, double ratio)
+{
+    self->context->rate = (uint32_t) ((AUDIO_FREQUENCY * ratio) + 0.5);
+}
+
+static void schedule(SoundClass *self)
+{
+    self->parent->scheduler->schedule(self->parent->scheduler, EV_SOUND,
+        self->parent->context->ticks
+            + ((uint64_t) AUDIO_SYNC_FRAMES * DOTS_PER_SECOND
+                / AUDIO_FREQUENCY));
+}
+
+/* Flushes periodically so the device is fed between register accesses */
+static void tick(SoundClass *self)
+{
+    self->sync(self);
+    self->schedule(self);
+}
+
+static void audio_callback(void *userdata, uint8_t *stream, int32_t len)
+{
+    SoundClass *self = (SoundClass *) userdata;
+    size_t count = len / (AUDIO_CHANNELS * sizeof(int16_t));
+    size_t copied = self->pop(self, (int16_t *) stream, count);
+
+    if (copied < count) {
+        atomic_fetch_add_explicit(
+            &self->context->ring.underruns, 1, memory_order_relaxed);
+        memset(stream + (copied * AUDIO_CHANNELS * sizeof(int16_t)), 0,
+            (count - copied) * AUDIO_CHANNELS * sizeof(int16_t));
+    }
+}
+
+static void clock_length(bool *enabled, uint16_t *counter, bool length)
+{
+    if (length && *counter && --*counter == 0) {
+        *enabled = false;
+    }
+}
+
+static void clock_envelope(
+    uint8_t *volume, uint8_t *timer, uint8_t sweep, uint8_t direction)
+{
+    if (sweep == 0) {
+        return;
+    }
+    if (*timer > 1) {
+        (*timer)--;
+        return;
+    }
+
+    *timer = sweep;
+    if (direction) {
+        if (*volume < 15) {
+            (*volume)++;
+        }
+    } else {
+        if (*volume > 0) {
+            (*volume)--;
+        }
     }
 }
 
-static void update_channel1(SoundClass *self, float_t dt)
+static uint16_t sweep_frequency(SoundClass *self)
 {
     sound_channel1_t *channel = &self->context->channel1;
-    channel->time_counter += dt;
+    uint16_t offset = channel->shadow_frequency >> channel->sweep_shift;
 
-    if (channel->envelope_sweep > 0) {
-        channel->envelope_counter += dt;
-        float_t envelope_period = channel->envelope_sweep / 64.0f;
+    return channel->sweep_direction ? channel->shadow_frequency - offset
+                                    : channel->shadow_frequency + offset;
+}
 
-        if (channel->envelope_counter >= envelope_period) {
-            channel->envelope_counter -= envelope_period;
+static void clock_sweep(SoundClass *self)
+{
+    sound_channel1_t *channel = &self->context->channel1;
 
-            if (channel->envelope_direction) {
-                if (channel->volume < 15) {
-                    channel->volume++;
-                }
-            } else {
-                if (channel->volume > 0) {
-                    channel->volume--;
-                }
-            }
+    if (channel->sweep_timer > 1) {
+        channel->sweep_timer--;
+        return;
+    }
+
+    channel->sweep_timer = channel->sweep_time ? channel->sweep_time : 8;
+    if (!channel->sweep_enabled || channel->sweep_time == 0) {
+        return;
+    }
+
+    uint16_t frequency = self->sweep_frequency(self);
+
+    if (frequency > 2047) {
+        channel->enabled = false;
+    } else if (channel->sweep_shift) {
+        channel->shadow_frequency = frequency;
+        channel->frequency = frequency;
+        channel->freq_lo = frequency & 0xFF;
+        channel->freq_hi = (frequency >> 8) & 0x07;
+        channel->period = (2048 - frequency) * 4;
+
+        if (self->sweep_frequency(self) > 2047) {
+            channel->enabled = false;
         }
     }
+}
+
+/*
+ * 512 Hz frame sequencer: lengths on even steps, the sweep on steps 2 and
+ * 6 and envelopes on step 7, counted from the edge's absolute position.
+ */
+static void sequence(SoundClass *self, uint64_t edge)
+{
+    sound_context_t *context = self->context;
+    uint8_t step = (edge / APU_FRAME_TICKS) & 0x07;
+
+    if (!(context->master_on & 0x80)) {
+        return;
+    }
 
-    if (channel->sweep_time > 0 && channel->sweep_shift > 0) {
-        channel->sweep_counter += dt;
-        float_t sweep_period = channel->sweep_time / 128.0f;
+    if (step % 2 == 0) {
+        clock_length(&context->channel1.enabled,
+            &context->channel1.length_counter,
+            context->channel1.length_enabled);
+        clock_length(&context->channel2.enabled,
+            &context->channel2.length_counter,
+            context->channel2.length_enabled);
+        clock_length(&context->channel3.enabled,
+            &context->channel3.length_counter,
+            context->channel3.length_enabled);
+        clock_length(&context->channel4.enabled,
+            &context->channel4.length_counter,
+            context->channel4.length_enabled);
+    }
 
-        if (channel->sweep_counter >= sweep_period) {
-            channel->sweep_counter -= sweep_period;
+    if (step == 2 || step == 6) {
+        self->clock_sweep(self);
+    }
 
-            uint16_t offset = channel->frequency >> channel->sweep_shift;
+    if (step == 7) {
+        clock_envelope(&context->channel1.volume,
+            &context->channel1.envelope_timer,
+            context->channel1.envelope_sweep,
+            context->channel1.envelope_direction);
+        clock_envelope(&context->channel2.volume,
+            &context->channel2.envelope_timer,
+            context->channel2.envelope_sweep,
+            context->channel2.envelope_direction);
+        clock_envelope(&context->channel4.volume,
+            &context->channel4.envelope_timer,
+            context->channel4.envelope_sweep,
+            context->channel4.envelope_direction);
+    }
 
-            if (channel->sweep_direction) {
-                if (channel->frequency >= offset) {
-                    channel->frequency -= offset;
-                } else {
-                    channel->enabled = false;
-                }
-            } else {
-                channel->frequency += offset;
+    self->mix(self, edge);
+}
 
-                if (channel->frequency > 2047) {
-                    channel->enabled = false;
-                }
-            }
+/*
+ * Each channel counts its frequency timer down in ticks from last_sync and
+ * only touches the step buffer when its output actually changes. A silent
+ * channel just moves its waveform position forward in one go.
+ */
+static void update_channel1(SoundClass *self, uint64_t until)
+{
+    sound_channel1_t *channel = &self->context->channel1;
+    if (!channel->enabled || channel->period == 0) {
+        return;
+    }
+
+    uint64_t time = self->context->last_sync + channel->timer;
+    int32_t sample = self->get_channel1_sample(self);
+
+    if (time <= until && sample == 0) {
+        uint64_t steps = ((until - time) / channel->period) + 1;
 
-            channel->period = 131072 / (2048 - channel->frequency);
+        channel->duty_step = (channel->duty_step + steps) & 0x07;
+        time += steps * channel->period;
+    }
+
+    for (; time <= until; time += channel->period) {
+        channel->duty_step = (channel->duty_step + 1) & 0x07;
+
+        int32_t next = self->get_channel1_sample(self);
+        if (next != sample) {
+            self->output(self, 0, next - sample, time);
+            sample = next;
         }
     }
+    channel->timer = time - until;
 }
 
-static void update_channel2(SoundClass *self, float_t dt)
+static void update_channel2(SoundClass *self, uint64_t until)
 {
     sound_channel2_t *channel = &self->context->channel2;
-    channel->time_counter += dt;
+    if (!channel->enabled || channel->period == 0) {
+        return;
+    }
 
-    if (channel->envelope_sweep > 0) {
-        channel->envelope_counter += dt;
-        float_t envelope_period = channel->envelope_sweep / 64.0f;
+    uint64_t time = self->context->last_sync + channel->timer;
+    int32_t sample = self->get_channel2_sample(self);
 
-        if (channel->envelope_counter >= envelope_period) {
-            channel->envelope_counter -= envelope_period;
+    if (time <= until && sample == 0) {
+        uint64_t steps = ((until - time) / channel->period) + 1;
 
-            if (channel->envelope_direction) {
-                if (channel->volume < 15) {
-                    channel->volume++;
-                }
-            } else {
-                if (channel->volume > 0) {
-                    channel->volume--;
-                }
-            }
+        channel->duty_step = (channel->duty_step + steps) & 0x07;
+        time += steps * channel->period;
+    }
+
+    for (; time <= until; time += channel->period) {
+        channel->duty_step = (channel->duty_step + 1) & 0x07;
+
+        int32_t next = self->get_channel2_sample(self);
+        if (next != sample) {
+            self->output(self, 1, next - sample, time);
+            sample = next;
         }
     }
+    channel->timer = time - until;
 }
 
-static void update_channel3(SoundClass *self, float_t dt)
+static void update_channel3(SoundClass *self, uint64_t until)
 {
     sound_channel3_t *channel = &self->context->channel3;
-    channel->time_counter += dt;
-}
+    if (!channel->enabled || channel->period == 0) {
+        return;
+    }
 
-static void update_channel4(SoundClass *self, float_t dt)
-{
-    sound_channel4_t *channel = &self->context->channel4;
-    channel->time_counter += dt;
+    uint64_t time = self->context->last_sync + channel->timer;
+    int32_t sample = self->get_channel3_sample(self);
 
-    if (channel->envelope_sweep > 0) {
-        channel->envelope_counter += dt;
-        float_t envelope_period = channel->envelope_sweep / 64.0f;
+    if (time <= until && channel->volume == 0) {
+        uint64_t steps = ((until - time) / channel->period) + 1;
 
-        if (channel->envelope_counter >= envelope_period) {
-            channel->envelope_counter -= envelope_period;
+        channel->position = (channel->position + steps) & 0x1F;
+        time += steps * channel->period;
+    }
 
-            if (channel->envelope_direction) {
-                if (channel->volume < 15) {
-                    channel->volume++;
-                }
-            } else {
-                if (channel->volume > 0) {
-                    channel->volume--;
-                }
-            }
+    for (; time <= until; time += channel->period) {
+        channel->position = (channel->position + 1) & 0x1F;
+
+        int32_t next = self->get_channel3_sample(self);
+        if (next != sample) {
+            self->output(self, 2, next - sample, time);
+            sample = next;
         }
     }
+    channel->timer = time - until;
+}
 
-    if (channel->period == 0) {
+static void update_channel4(SoundClass *self, uint64_t until)
+{
+    sound_channel4_t *channel = &self->context->channel4;
+    if (!channel->enabled || channel->period == 0) {
         return;
     }
 
-    int32_t noise_freq = 524288 / channel->period;
-    float_t steps = dt * noise_freq;
+    uint64_t time = self->context->last_sync + channel->timer;
+    int32_t sample = self->get_channel4_sample(self);
+    int32_t amplitude = sample < 0 ? -sample : sample;
+
+    /* silent: jump the LFSR over every clock up to until at once */
+    if (time <= until && amplitude == 0) {
+        uint64_t steps = ((until - time) / channel->period) + 1;
+        uint16_t (*jump)[LFSR_BITS] =
+            self->context->lfsr_jump[channel->counter_width ? 1 : 0];
 
-    for (int32_t i = 0; i < steps; i++) {
-        uint8_t bit = (channel->lfsr & 0x1) ^ ((channel->lfsr >> 1) & 0x1);
+        time += steps * channel->period;
+        for (int32_t k = 0; steps; k++, steps >>= 1) {
+            if (steps & 0x1) {
+                channel->lfsr = apply_lfsr(jump[k], channel->lfsr);
+            }
+        }
+    }
 
-        channel->lfsr >>= 1;
-        channel->lfsr |= (bit << 14);
+    for (; time <= until; time += channel->period) {
+        channel->lfsr = clock_lfsr(channel->lfsr, channel->counter_width);
 
-        if (channel->counter_width) {
-            channel->lfsr &= ~(1 << 6);
-            channel->lfsr |= (bit << 6);
+        int32_t next = (channel->lfsr & 0x1) ? amplitude : -amplitude;
+        if (next != sample) {
+            self->output(self, 3, next - sample, time);
+            sample = next;
         }
     }
+    channel->timer = time - until;
 }
 
 static void update_volume(SoundClass *self, bool up)
@@ -756,19 +1138,38 @@ const SoundClass init_sound = {
         ._destructor = destructor,
     },
     .duty_cycles = {0, 1, 2, 3},
+    .duty_waveforms = {0x80, 0x81, 0xE1, 0x7E},
     .volume_levels = {0, 15, 7, 3},
     .read = read,
     .write = write,
     .update = update,
     .audio_callback = audio_callback,
+    .mix = mix,
+    .output = output,
+    .add_delta = add_delta,
+    .flush = flush,
+    .push = push,
+    .pop = pop,
+    .sync = sync,
+    .sequence = sequence,
+    .buffered = buffered,
+    .played = played,
+    .trim = trim,
+    .set_rate = set_rate,
+    .schedule = schedule,
+    .tick = tick,
     .update_channel1 = update_channel1,
     .update_channel2 = update_channel2,
     .update_channel3 = update_channel3,
     .update_channel4 = update_channel4,
+    .sweep_frequency = sweep_frequency,
+    .clock_sweep = clock_sweep,
     .get_channel1_sample = get_channel1_sample,
     .get_channel2_sample = get_channel2_sample,
     .get_channel3_sample = get_channel3_sample,
     .get_channel4_sample = get_channel4_sample,
+    .init_kernel = init_kernel,
+    .init_lfsr = init_lfsr,
     .init_sound_system = init_sound_system,
     .update_volume = update_volume,
 };
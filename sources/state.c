@@ -0,0 +1,524 @@
+#include "../include/gameboy.h"
+
+#define FIELD(stream, value) field(stream, &(value), sizeof(value))
+
+static void constructor(void *ptr, va_list *args)
+{
+    StateClass *self = (StateClass *) ptr;
+    if (!((self->context = calloc(1, sizeof(*self->context))))) {
+        HANDLE_ERROR("failed memory allocation");
+    }
+    self->parent = va_arg(*args, GameboyClass *);
+}
+
+static void destructor(void *ptr)
+{
+    StateClass *self = (StateClass *) ptr;
+    free(self->context);
+}
+
+/*
+ * Copies one value in or out of the stream. A saving stream without a
+ * buffer only measures, so the same chunk functions size, write and read.
+ */
+static void field(state_stream_t *stream, void *value, size_t size)
+{
+    if (stream->loading) {
+        if (stream->position + size > stream->size) {
+            stream->failed = true;
+            return;
+        }
+        memcpy(value, stream->data + stream->position, size);
+    } else if (stream->data) {
+        if (stream->position + size > stream->size) {
+            stream->failed = true;
+            return;
+        }
+        memcpy(stream->data + stream->position, value, size);
+    }
+    stream->position += size;
+}
+
+static int8_t sprite_index(ppu_context_t *ppu, oam_line_entry_t *entry)
+{
+    return entry ? entry - ppu->line_entry_array : STATE_NONE;
+}
+
+static oam_line_entry_t *sprite_entry(ppu_context_t *ppu, int8_t index)
+{
+    if (index < 0 || index >= MAX_SPRITES) {
+        return NULL;
+    }
+    return &ppu->line_entry_array[index];
+}
+
+static void sync_rom(StateClass *self, state_stream_t *stream)
+{
+    cartridge_context_t *cartridge = self->parent->cartridge->context;
+    uint32_t rom_size = cartridge->rom_size;
+    uint8_t checksum = cartridge->header->checksum;
+    uint16_t global_checksum = cartridge->header->global_checksum;
+
+    /* identifies the ROM only: never written back */
+    FIELD(stream, rom_size);
+    FIELD(stream, checksum);
+    FIELD(stream, global_checksum);
+
+    if (stream->loading
+        && (rom_size != cartridge->rom_size
+            || checksum != cartridge->header->checksum
+            || global_checksum != cartridge->header->global_checksum)) {
+        stream->failed = true;
+    }
+}
+
+static void sync_emulator(StateClass *self, state_stream_t *stream)
+{
+    emulator_context_t *emulator = self->parent->context;
+
+    FIELD(stream, emulator->ticks);
+    FIELD(stream, emulator->hw_mode);
+    FIELD(stream, emulator->double_speed);
+    FIELD(stream, emulator->speed_switch_armed);
+    FIELD(stream, emulator->stop_cycles_remaining);
+}
+
+static void sync_cpu(StateClass *self, state_stream_t *stream)
+{
+    cpu_context_t *cpu = self->parent->cpu->context;
+
+    /* F is stored resolved, so no lazy flag state is carried over */
+    self->parent->cpu->flags(self->parent->cpu);
+    FIELD(stream, cpu->registers);
+    FIELD(stream, cpu->opcode);
+    FIELD(stream, cpu->halted);
+    FIELD(stream, cpu->stepping);
+    FIELD(stream, cpu->int_master_enabled);
+    FIELD(stream, cpu->enabling_ime);
+    FIELD(stream, cpu->ie_register);
+    FIELD(stream, cpu->int_flags);
+}
+
+static void sync_ram(StateClass *self, state_stream_t *stream)
+{
+    FIELD(stream, *self->parent->ram->context);
+}
+
+static void sync_timer(StateClass *self, state_stream_t *stream)
+{
+    FIELD(stream, *self->parent->timer->context);
+}
+
+static void sync_scheduler(StateClass *self, state_stream_t *stream)
+{
+    FIELD(stream, *self->parent->scheduler->context);
+}
+
+static void sync_ppu(StateClass *self, state_stream_t *stream)
+{
+    ppu_context_t *ppu = self->parent->ppu->context;
+    int8_t head = sprite_index(ppu, ppu->line_sprites);
+
+    if (!stream->loading) {
+        self->parent->dma->sync(
+            self->parent->dma, self->parent->context->ticks);
+    }
+    FIELD(stream, ppu->oam_ram);
+    FIELD(stream, ppu->vram);
+    FIELD(stream, ppu->vram_bank);
+
+    if (stream->loading) {
+        self->parent->ppu->touch_tile(
+            self->parent->ppu, 0, sizeof(ppu->vram));
+    }
+    FIELD(stream, *ppu->pixel_context);
+    FIELD(stream, ppu->line_sprite_count);
+    FIELD(stream, head);
+
+    for (int32_t i = 0; i < MAX_SPRITES; i++) {
+        oam_line_entry_t *entry = &ppu->line_entry_array[i];
+        int8_t next = sprite_index(ppu, entry->next);
+
+        FIELD(stream, entry->entry);
+        FIELD(stream, next);
+
+        if (stream->loading) {
+            entry->next = sprite_entry(ppu, next);
+        }
+    }
+
+    if (stream->loading) {
+        ppu->line_sprites = sprite_entry(ppu, head);
+    }
+
+    FIELD(stream, ppu->fetch_entry_count);
+    FIELD(stream, ppu->fetched_entries);
+    FIELD(stream, ppu->window_line);
+    FIELD(stream, ppu->current_frame);
+    FIELD(stream, ppu->line_ticks);
+    FIELD(stream, ppu->last_sync);
+    FIELD(stream, ppu->window_triggered);
+    FIELD(stream, ppu->window_rendered_this_line);
+    FIELD(stream, ppu->scanline_pending);
+    FIELD(stream, ppu->transfer_start);
+    FIELD(stream, ppu->transfer_end);
+}
+
+static void sync_video(StateClass *self, state_stream_t *stream)
+{
+    PPUClass *ppu = self->parent->ppu;
+
+    field(stream, ppu->context->video_buffer,
+        X_RES * Y_RES * sizeof(uint32_t));
+
+    if (stream->loading) {
+        ppu->publish(ppu);
+    }
+}
+
+static void sync_lcd(StateClass *self, state_stream_t *stream)
+{
+    FIELD(stream, *self->parent->lcd->context);
+}
+
+static void sync_dma(StateClass *self, state_stream_t *stream)
+{
+    FIELD(stream, *self->parent->dma->context);
+}
+
+static void sync_serial(StateClass *self, state_stream_t *stream)
+{
+    FIELD(stream, self->parent->io->serial_data);
+}
+
+static void sync_joypad(StateClass *self, state_stream_t *stream)
+{
+    FIELD(stream, *self->parent->joypad->context);
+}
+
+static void sync_sound(StateClass *self, state_stream_t *stream)
+{
+    sound_context_t *sound = self->parent->sound->context;
+
+    FIELD(stream, sound->master_volume);
+    FIELD(stream, sound->channel_control);
+    FIELD(stream, sound->output_select);
+    FIELD(stream, sound->master_on);
+    FIELD(stream, sound->channel1);
+    FIELD(stream, sound->channel2);
+    FIELD(stream, sound->channel3);
+    FIELD(stream, sound->channel4);
+    FIELD(stream, sound->last_sync);
+    FIELD(stream, sound->sample_phase);
+}
+
+static void sync_cartridge(StateClass *self, state_stream_t *stream)
+{
+    CartridgeClass *cartridge = self->parent->cartridge;
+    cartridge_context_t *context = cartridge->context;
+    uint32_t rom_offset = context->rom_bank_x
+        ? (uint32_t) (context->rom_bank_x - context->rom_data)
+        : UINT32_MAX;
+    int8_t ram_index = STATE_NONE;
+    int64_t rtc_last_time = context->rtc_last_time;
+
+    for (int8_t i = 0; i < 16; i++) {
+        if (context->ram_bank && context->ram_bank == context->ram_banks[i]) {
+            ram_index = i;
+            break;
+        }
+    }
+
+    FIELD(stream, context->ram_enabled);
+    FIELD(stream, context->ram_banking);
+    FIELD(stream, rom_offset);
+    FIELD(stream, context->banking_mode);
+    FIELD(stream, context->rom_bank_value);
+    FIELD(stream, context->ram_bank_value);
+    FIELD(stream, ram_index);
+    FIELD(stream, context->rtc_s);
+    FIELD(stream, context->rtc_m);
+    FIELD(stream, context->rtc_h);
+    FIELD(stream, context->rtc_dl);
+    FIELD(stream, context->rtc_dh);
+    FIELD(stream, context->rtc_selected);
+    FIELD(stream, context->rtc_reg);
+    FIELD(stream, context->rtc_latch);
+    FIELD(stream, rtc_last_time);
+    FIELD(stream, context->mbc6_rom_bank1);
+    FIELD(stream, context->mbc6_rom_bank2);
+    FIELD(stream, context->mbc6_ram_bank1);
+    FIELD(stream, context->mbc6_ram_bank2);
+    FIELD(stream, context->mbc7_state);
+    FIELD(stream, context->mbc7_buffer);
+    FIELD(stream, context->mbc7_output);
+    FIELD(stream, context->mbc7_cs);
+    FIELD(stream, context->mbc7_clk);
+    FIELD(stream, context->mbc7_prev_clk);
+
+    for (int32_t i = 0; i < 16; i++) {
+        if (cartridge->set_banks & (1 << i)) {
+            field(stream, context->ram_banks[i],
+                (cartridge->mbc_2(cartridge) && i == 0) ? 512 : 0x2000);
+        }
+    }
+
+    if (stream->loading) {
+        context->rom_bank_x = rom_offset == UINT32_MAX
+            ? NULL
+            : context->rom_data + rom_offset;
+        context->ram_bank = (ram_index < 0 || ram_index >= 16)
+            ? NULL
+            : context->ram_banks[ram_index];
+        context->rtc_last_time = (time_t) rtc_last_time;
+        context->needs_save = context->has_battery;
+    }
+}
+
+static size_t save_chunks(
+    StateClass *self, uint8_t *buffer, size_t capacity, uint32_t mask)
+{
+    state_stream_t stream = {.data = buffer, .size = capacity};
+    uint32_t magic = STATE_MAGIC;
+    uint32_t version = STATE_VERSION;
+    uint32_t count = 0;
+
+    for (int32_t i = 0; i < STATE_CHUNKS; i++) {
+        count += (mask >> i) & 1;
+    }
+
+    FIELD(&stream, magic);
+    FIELD(&stream, version);
+    FIELD(&stream, count);
+
+    for (int32_t i = 0; i < STATE_CHUNKS; i++) {
+        if (!(mask & (1 << i))) {
+            continue;
+        }
+
+        uint32_t tag = self->chunks[i].tag;
+        uint32_t length = 0;
+
+        FIELD(&stream, tag);
+        size_t length_at = stream.position;
+        FIELD(&stream, length);
+
+        size_t start = stream.position;
+        self->chunks[i].sync(self, &stream);
+        length = stream.position - start;
+
+        if (stream.data && !stream.failed) {
+            memcpy(stream.data + length_at, &length, sizeof(length));
+        }
+    }
+
+    return stream.failed ? 0 : stream.position;
+}
+
+static size_t save(StateClass *self, uint8_t *buffer, size_t capacity)
+{
+    return self->save_chunks(self, buffer, capacity, STATE_ALL);
+}
+
+static size_t size(StateClass *self)
+{
+    return self->save(self, NULL, 0);
+}
+
+static int32_t find_chunk(StateClass *self, uint32_t tag)
+{
+    for (int32_t i = 0; i < STATE_CHUNKS; i++) {
+        if (self->chunks[i].tag == tag) {
+            return i;
+        }
+    }
+    return STATE_NONE;
+}
+
+/*
+ * Walks the chunks twice: the first pass checks the header, the ROM and
+ * every chunk length against what this build would write, so a rejected
+ * state never leaves the machine half restored. Unknown chunks are skipped
+ * and the framebuffer is optional.
+ */
+static bool load(StateClass *self, const uint8_t *buffer, size_t size)
+{
+    state_stream_t stream = {
+        .data = (uint8_t *) buffer, .size = size, .loading = true};
+    uint32_t magic = 0;
+    uint32_t version = 0;
+    uint32_t count = 0;
+
+    FIELD(&stream, magic);
+    FIELD(&stream, version);
+    FIELD(&stream, count);
+
+    if (stream.failed || magic != STATE_MAGIC || version != STATE_VERSION) {
+        return false;
+    }
+
+    size_t first = stream.position;
+
+    for (int32_t pass = 0; pass < 2; pass++) {
+        uint32_t seen = 0;
+        stream.position = first;
+
+        for (uint32_t n = 0; n < count; n++) {
+            uint32_t tag = 0;
+            uint32_t length = 0;
+
+            FIELD(&stream, tag);
+            FIELD(&stream, length);
+
+            if (stream.failed || length > stream.size - stream.position) {
+                return false;
+            }
+
+            int32_t i = find_chunk(self, tag);
+            state_stream_t chunk = {
+                .data = stream.data + stream.position,
+                .size = length,
+                .loading = true,
+            };
+            stream.position += length;
+
+            if (i == STATE_NONE) {
+                continue;
+            }
+
+            if (pass == 0) {
+                state_stream_t measure = {0};
+                self->chunks[i].sync(self, &measure);
+                if (measure.position != length) {
+                    return false;
+                }
+                /* the ROM chunk only compares, so it is safe to run now */
+                if (i == 0) {
+                    self->chunks[i].sync(self, &chunk);
+                }
+            } else {
+                self->chunks[i].sync(self, &chunk);
+            }
+
+            if (chunk.failed) {
+                return false;
+            }
+            seen |= 1 << i;
+        }
+
+        if ((seen & STATE_NO_VIDEO) != STATE_NO_VIDEO) {
+            return false;
+        }
+    }
+
+    self->parent->bus->remap(self->parent->bus);
+
+    return true;
+}
+
+static bool save_file(StateClass *self, const char *path)
+{
+    size_t length = self->size(self);
+    uint8_t *buffer = malloc(length);
+
+    if (!buffer) {
+        HANDLE_ERROR("failed memory allocation");
+    }
+
+    FILE *stream = fopen(path, "wb");
+    bool saved = stream && self->save(self, buffer, length) == length
+        && fwrite(buffer, length, 1, stream) == 1;
+
+    if (stream) {
+        fclose(stream);
+    }
+    free(buffer);
+
+    return saved;
+}
+
+static bool load_file(StateClass *self, const char *path)
+{
+    FILE *stream = fopen(path, "rb");
+    if (!stream) {
+        return false;
+    }
+
+    fseek(stream, 0, SEEK_END);
+    long length = ftell(stream);
+    rewind(stream);
+
+    uint8_t *buffer = length > 0 ? malloc(length) : NULL;
+    bool loaded = buffer && fread(buffer, length, 1, stream) == 1
+        && self->load(self, buffer, length);
+
+    fclose(stream);
+    free(buffer);
+
+    return loaded;
+}
+
+/* Called from the UI thread; service() picks it up */
+static void request(StateClass *self, state_request_t request)
+{
+    atomic_store_explicit(
+        &self->context->request, request, memory_order_relaxed);
+}
+
+/* Runs a pending request on the emulation thread, between instructions */
+static void service(StateClass *self)
+{
+    state_request_t request = atomic_exchange_explicit(
+        &self->context->request, STATE_IDLE, memory_order_relaxed);
+
+    if (request == STATE_IDLE) {
+        return;
+    }
+
+    char name[1030] = {0};
+    snprintf(name, sizeof(name), "%s.state",
+        self->parent->cartridge->context->filename);
+
+    if (request == STATE_SAVE) {
+        LOG(self->save_file(self, name) ? "State saved"
+                                        : "Failed to save state");
+    } else {
+        LOG(self->load_file(self, name) ? "State loaded"
+                                        : "Failed to load state");
+    }
+}
+
+const StateClass init_state = {
+    {
+        ._size = sizeof(StateClass),
+        ._name = "State",
+        ._constructor = constructor,
+        ._destructor = destructor,
+    },
+    .chunks = {
+        {STATE_TAG('R', 'O', 'M', ' '), sync_rom},
+        {STATE_TAG('E', 'M', 'U', ' '), sync_emulator},
+        {STATE_TAG('C', 'P', 'U', ' '), sync_cpu},
+        {STATE_TAG('R', 'A', 'M', ' '), sync_ram},
+        {STATE_TAG('T', 'I', 'M', 'R'), sync_timer},
+        {STATE_TAG('S', 'C', 'H', 'D'), sync_scheduler},
+        {STATE_TAG('P', 'P', 'U', ' '), sync_ppu},
+        {STATE_TAG('L', 'C', 'D', ' '), sync_lcd},
+        {STATE_TAG('D', 'M', 'A', ' '), sync_dma},
+        {STATE_TAG('S', 'I', 'O', ' '), sync_serial},
+        {STATE_TAG('J', 'O', 'Y', 'P'), sync_joypad},
+        {STATE_TAG('A', 'P', 'U', ' '), sync_sound},
+        {STATE_TAG('C', 'A', 'R', 'T'), sync_cartridge},
+        {STATE_TAG('V', 'I', 'D', 'E'), sync_video},
+    },
+    .size = size,
+    .save = save,
+    .save_chunks = save_chunks,
+    .load = load,
+    .save_file = save_file,
+    .load_file = load_file,
+    .request = request,
+    .service = service,
+};
+
+const class_t *State = (const class_t *) &init_state;
@@ -16,41 +16,82 @@ static void destructor(void *ptr)
     free(self->context);
 }
 
-static void tick(TimerClass *self)
+static bool signal(TimerClass *self)
 {
-    bool timer_update = false;
-    uint16_t prev_div = self->context->div;
-
-    self->context->div += 1;
-    switch (self->context->tac & (0b11)) {
-        case 0b00:
-            timer_update =
-                (prev_div & (1 << 9)) && (!(self->context->div & (1 << 9)));
-            break;
-        case 0b01:
-            timer_update =
-                (prev_div & (1 << 3)) && (!(self->context->div & (1 << 3)));
-            break;
-        case 0b10:
-            timer_update =
-                (prev_div & (1 << 5)) && (!(self->context->div & (1 << 5)));
-            break;
-        case 0b11:
-            timer_update =
-                (prev_div & (1 << 7)) && (!(self->context->div & (1 << 7)));
-            break;
-    }
-    if (timer_update && self->context->tac & (1 << 2)) {
-        self->context->tima += 1;
-        if (self->context->tima == 0xFF) {
-            self->context->tima = self->context->tma;
-            self->parent->cpu->request_interrupt(self->parent->cpu, IT_TIMER);
+    return (self->context->tac & (1 << 2))
+        && (self->context->div >> self->bits[self->context->tac & 0b11]) & 1;
+}
+
+/* Applies increments to TIMA, reloading from TMA each time it hits 0xFF */
+static void advance(TimerClass *self, uint64_t increments)
+{
+    while (increments) {
+        uint32_t left = (uint8_t) (0xFE - self->context->tima) + 1;
+
+        if (increments < left) {
+            self->context->tima += increments;
+            return;
         }
+        increments -= left;
+        self->context->tima = self->context->tma;
+        self->parent->cpu->request_interrupt(self->parent->cpu, IT_TIMER);
     }
 }
 
+/*
+ * DIV is the system counter advanced by the ticks elapsed since the last
+ * sync, and TIMA by the falling edges of the selected counter bit within
+ * that span, so neither needs per-cycle work.
+ */
+static void sync(TimerClass *self)
+{
+    uint64_t now = self->parent->context->ticks;
+    uint64_t elapsed = now - self->context->last_sync;
+
+    if (self->context->tac & (1 << 2)) {
+        uint8_t shift = self->bits[self->context->tac & 0b11] + 1;
+        uint64_t div = self->context->div;
+
+        self->advance(self, ((div + elapsed) >> shift) - (div >> shift));
+    }
+
+    self->context->div += (uint16_t) elapsed;
+    self->context->last_sync = now;
+}
+
+/* Only the edge that makes TIMA reload needs an event */
+static void schedule(TimerClass *self)
+{
+    if (!(self->context->tac & (1 << 2))) {
+        self->parent->scheduler->cancel(self->parent->scheduler, EV_TIMER);
+        return;
+    }
+
+    uint16_t period = 1 << (self->bits[self->context->tac & 0b11] + 1);
+    uint16_t elapsed = self->context->div & (period - 1);
+    uint32_t left = (uint8_t) (0xFE - self->context->tima) + 1;
+
+    self->parent->scheduler->schedule(self->parent->scheduler, EV_TIMER,
+        self->context->last_sync + (period - elapsed)
+            + (uint64_t) (left - 1) * period);
+}
+
+static void tick(TimerClass *self)
+{
+    self->sync(self);
+    self->schedule(self);
+}
+
+/*
+ * TIMA counts falling edges of (TAC enable AND the selected DIV bit), so
+ * resetting DIV or rewriting TAC while that signal is high bumps it once.
+ */
 static void write(TimerClass *self, uint16_t address, uint8_t value)
 {
+    self->sync(self);
+
+    bool before = self->signal(self);
+
     switch (address) {
         case DIV: self->context->div = 0; break;
         case TIMA: self->context->tima = value; break;
@@ -60,10 +101,18 @@ static void write(TimerClass *self, uint16_t address, uint8_t value)
             HANDLE_ERROR("Invalid Timer write");
         }
     }
+
+    if (before && !self->signal(self)) {
+        self->advance(self, 1);
+    }
+
+    self->schedule(self);
 }
 
 static uint8_t read(TimerClass *self, uint16_t address)
 {
+    self->sync(self);
+
     switch (address) {
         case DIV: return self->context->div >> 8;
         case TIMA: return self->context->tima;
@@ -82,7 +131,12 @@ const TimerClass init_timer = {
         ._constructor = constructor,
         ._destructor = destructor,
     },
+    .bits = {9, 3, 5, 7},
     .tick = tick,
+    .signal = signal,
+    .advance = advance,
+    .sync = sync,
+    .schedule = schedule,
     .write = write,
     .read = read,
 };
@@ -1,5 +1,6 @@
-#include <stdlib.h>
-#include "../include/gameboy.h"
+#ifndef HEADLESS
+    #include <stdlib.h>
+    #include "../include/gameboy.h"
 
 static void constructor(void *ptr, va_list *args)
 {
@@ -20,17 +21,16 @@ static void create_resources(UIClass *self)
     int32_t total_height = self->screen_height + 14 * 8 * self->scale;
     SDL_CreateWindowAndRenderer(
         total_width, total_height, 0, &self->window, &self->renderer);
-    self->screen =
-        SDL_CreateRGBSurface(0, self->screen_width, self->screen_height, 32,
-            0x00FF0000, 0x0000FF00, 0x000000FF, 0xFF000000);
+    /* frames are uploaded at native resolution and scaled by the renderer */
+    SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "nearest");
     self->texture = SDL_CreateTexture(self->renderer, SDL_PIXELFORMAT_ARGB8888,
-        SDL_TEXTUREACCESS_STREAMING, self->screen_width, self->screen_height);
-    self->debug_screen =
-        SDL_CreateRGBSurface(0, 16 * 8 * self->scale, 32 * 8 * self->scale, 32,
-            0x00FF0000, 0x0000FF00, 0x000000FF, 0xFF000000);
+        SDL_TEXTUREACCESS_STREAMING, X_RES, Y_RES);
+    self->debug_screen = SDL_CreateRGBSurface(0, 16 * 8, 32 * 8, 32,
+        0x00FF0000, 0x0000FF00, 0x000000FF, 0xFF000000);
     self->debug_texture = SDL_CreateTexture(self->renderer,
-        SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING,
-        16 * 8 * self->scale, 32 * 8 * self->scale);
+        SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, 16 * 8, 32 * 8);
+    SDL_FillRect(self->debug_screen, NULL, 0xFF111111);
+    self->debug_bank = -1;
 }
 
 static void destructor(void *ptr)
@@ -39,7 +39,6 @@ static void destructor(void *ptr)
     SDL_DestroyTexture(self->texture);
     SDL_DestroyTexture(self->debug_texture);
     SDL_FreeSurface(self->debug_screen);
-    SDL_FreeSurface(self->screen);
     SDL_DestroyRenderer(self->renderer);
     SDL_DestroyWindow(self->window);
     SDL_Quit();
@@ -63,77 +62,71 @@ static void handle_events(UIClass *self)
     }
 }
 
+/*
+ * The tile sheet is kept in debug_screen at native resolution. Only tiles
+ * the PPU flagged as written since the last frame are decoded again, and
+ * nothing is uploaded while VRAM is static. Switching the VRAM bank
+ * redraws the whole sheet.
+ */
 static void update_debug_window(UIClass *self)
 {
-    int32_t x_draw = 0;
-    int32_t y_draw = 0;
-    int32_t tile_num = 0;
-    int32_t width = self->debug_screen->w;
-    int32_t height = self->debug_screen->h;
+    ppu_context_t *ppu = self->parent->ppu->context;
+    int32_t bank = ppu->vram_bank;
+    bool redraw = bank != self->debug_bank;
+    bool changed = redraw;
 
-    SDL_FillRect(
-        self->debug_screen, &(SDL_Rect) {0, 0, width, height}, 0xFF111111);
+    self->debug_bank = bank;
 
-    for (int32_t y = 0; y < 32; y++) {
-        for (int32_t x = 0; x < 16; x++) {
-            self->display_tile(self, tile_num, x_draw + (x * 8 * self->scale),
-                y_draw + (y * 8 * self->scale));
-            tile_num += 1;
+    for (int32_t word = 0; word < TILE_COUNT / 32; word++) {
+        uint32_t dirty = atomic_exchange_explicit(
+            &ppu->tile_dirty[(bank * TILE_COUNT / 32) + word], 0,
+            memory_order_acquire);
+
+        if (redraw) {
+            dirty = UINT32_MAX;
+        }
+        changed |= dirty != 0;
+
+        for (int32_t bit = 0; dirty; bit++, dirty >>= 1) {
+            int32_t tile_num = (word * 32) + bit;
+
+            if (dirty & 0x01) {
+                self->display_tile(
+                    self, tile_num, (tile_num % 16) * 8, (tile_num / 16) * 8);
+            }
         }
     }
 
-    SDL_UpdateTexture(self->debug_texture, NULL, self->debug_screen->pixels,
-        self->debug_screen->pitch);
+    if (changed) {
+        SDL_UpdateTexture(self->debug_texture, NULL,
+            self->debug_screen->pixels, self->debug_screen->pitch);
+    }
 }
 
 static void display_tile(
     UIClass *self, uint16_t tile_num, int32_t x, int32_t y)
 {
-    for (int32_t tile_y = 0; tile_y < 16; tile_y += 2) {
-        uint8_t byte_1 = self->parent->bus->read(
-            self->parent->bus, START_LOCATION + (tile_num * 16) + tile_y);
-        uint8_t byte_2 = self->parent->bus->read(
-            self->parent->bus, START_LOCATION + (tile_num * 16) + tile_y + 1);
-
-        for (int32_t bit = 7; bit >= 0; bit--) {
-            uint8_t hi = !!(byte_1 & (1 << bit)) << 1;
-            uint8_t lo = !!(byte_2 & (1 << bit));
-            uint8_t color = hi | lo;
-
-            SDL_FillRect(self->debug_screen,
-                &(SDL_Rect) {
-                    x + ((7 - bit) * self->scale),
-                    y + (tile_y / 2 * self->scale),
-                    self->scale,
-                    self->scale,
-                },
-                self->tile_colors[color]);
-        }
+    PlanarClass *planar = self->parent->planar;
+    const uint64_t *rows =
+        self->parent->ppu->context->tile_cache[self->debug_bank][tile_num][0];
+    uint32_t *pixels = (uint32_t *) self->debug_screen->pixels;
+    int32_t pitch = self->debug_screen->pitch / sizeof(uint32_t);
+
+    for (int32_t tile_y = 0; tile_y < 8; tile_y++) {
+        planar->colorize(planar, rows[tile_y], self->tile_colors,
+            pixels + ((y + tile_y) * pitch) + x);
     }
 }
 
 static void update(UIClass *self)
 {
-    uint32_t *buffer = self->parent->ppu->context->video_buffer;
-
-    for (int32_t line_num = 0; line_num < Y_RES; line_num++) {
-        for (int32_t x = 0; x < X_RES; x++) {
-            SDL_FillRect(self->screen,
-                &(SDL_Rect) {
-                    .x = x * self->scale,
-                    .y = line_num * self->scale,
-                    .w = self->scale,
-                    .h = self->scale,
-                },
-                buffer[x + (line_num * X_RES)]);
-        }
-    }
+    ppu_context_t *ppu = self->parent->ppu->context;
 
-    SDL_UpdateTexture(
-        self->texture, NULL, self->screen->pixels, self->screen->pitch);
+    SDL_UpdateTexture(self->texture, NULL, ppu->frames[ppu->front_frame],
+        X_RES * sizeof(uint32_t));
     SDL_RenderClear(self->renderer);
     SDL_RenderCopy(self->renderer, self->texture, NULL,
-        &(SDL_Rect) {0, 0, self->screen_width * 2,
+        &(SDL_Rect) {0, 0, self->screen_width,
             (self->screen_height * 2) - (32 * self->scale)});
     self->update_debug_window(self);
     SDL_RenderCopy(self->renderer, self->debug_texture, NULL,
@@ -195,6 +188,35 @@ static void on_key(UIClass *self, bool down, SDL_Keycode code)
             self->parent->context->die = true;
             break;
         }
+        case SDLK_r: {
+            if (down) {
+                ppu_context_t *ppu = self->parent->ppu->context;
+                ppu->renderer = ppu->renderer == RENDERER_FIFO
+                    ? RENDERER_SCANLINE
+                    : RENDERER_FIFO;
+                LOG(ppu->renderer == RENDERER_FIFO ? "Renderer: FIFO"
+                                                   : "Renderer: scanline");
+            }
+            break;
+        }
+        case SDLK_BACKSPACE: {
+            self->parent->rewind->set_rewinding(self->parent->rewind, down);
+            break;
+        }
+        case SDLK_F5:
+        case SDLK_F9: {
+            if (down) {
+                self->parent->state->request(self->parent->state,
+                    code == SDLK_F5 ? STATE_SAVE : STATE_LOAD);
+            }
+            break;
+        }
+        case SDLK_f: {
+            if (down) {
+                self->parent->pacer->toggle(self->parent->pacer);
+            }
+            break;
+        }
         case SDLK_u:
         case SDLK_d: {
             self->parent->sound->update_volume(
@@ -223,3 +245,4 @@ const UIClass init_ui = {
 };
 
 const class_t *UI = (const class_t *) &init_ui;
+#endif
@@ -0,0 +1,58 @@
+#ifdef HEADLESS
+    #define _POSIX_C_SOURCE 199309L
+    #include <time.h>
+    #include "../include/gameboy.h"
+
+static void constructor(void *ptr, va_list *args)
+{
+    UIClass *self = (UIClass *) ptr;
+    self->parent = va_arg(*args, GameboyClass *);
+    self->screen_height = va_arg(*args, int32_t);
+    self->screen_width = va_arg(*args, int32_t);
+    self->scale = va_arg(*args, int32_t);
+    LOG("Running headless");
+}
+
+static void handle_events(UIClass UNUSED *self)
+{
+}
+
+static void update(UIClass UNUSED *self)
+{
+    /* the host takes finished frames with gb_get_framebuffer */
+}
+
+static uint32_t get_ticks(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (now.tv_sec * 1000) + (now.tv_nsec / 1000000);
+}
+
+static void delay(uint32_t ms)
+{
+    nanosleep(
+        &(struct timespec) {
+            .tv_sec = ms / 1000,
+            .tv_nsec = (ms % 1000) * 1000000,
+        },
+        NULL);
+}
+
+const UIClass init_ui = {
+    {
+        ._size = sizeof(UIClass),
+        ._name = "UI",
+        ._constructor = constructor,
+        ._destructor = NULL,
+    },
+    .tile_colors = {0xFFFFFFFF, 0xFFAAAAAA, 0xFF555555, 0xFF000000},
+    .handle_events = handle_events,
+    .update = update,
+    .get_ticks = get_ticks,
+    .delay = delay,
+};
+
+const class_t *UI = (const class_t *) &init_ui;
+#endif